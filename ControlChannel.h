@@ -0,0 +1,111 @@
+#pragma once
+// ===================================================================================
+// ControlChannel.h - Runtime commands for a running engine (hotkeys, control socket)
+// ===================================================================================
+
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+enum class ControlCommand {
+    None,
+    Quit,
+    Panic,         // All notes off
+    Bank,          // Select bank (absolute)
+    BankNext,
+    BankPrevious,
+    Stats,
+    Help
+};
+
+// Number of banks: a bank shifts every mapping's MIDI channel, so there is one per channel
+const int CONTROL_BANK_COUNT = 16;
+
+// Single-key commands of the monitoring terminal. bank receives the bank for
+// ControlCommand::Bank.
+inline ControlCommand HotkeyCommand(char key, int& bank) {
+    if (key >= '0' && key <= '9') {
+        bank = key - '0';
+        return ControlCommand::Bank;
+    }
+    switch (key) {
+        case '\n': case '\r': case 'q': case 'Q': return ControlCommand::Quit;
+        case 'p': case 'P': return ControlCommand::Panic;
+        case '+': case '=': return ControlCommand::BankNext;
+        case '-': return ControlCommand::BankPrevious;
+        case 's': case 'S': return ControlCommand::Stats;
+        case 'h': case 'H': case '?': return ControlCommand::Help;
+        default: return ControlCommand::None;
+    }
+}
+
+const char* const HOTKEY_HELP = "Keys: q/Enter quit, p panic (all notes off), 0-9 bank, +/- next/previous bank, s stats";
+
+// One line of the control socket protocol: "quit", "panic", "bank N", "bank +", "bank -",
+// "stats" or "help" (case-insensitive, surrounding whitespace ignored). Returns None for
+// anything else.
+inline ControlCommand ParseControlCommand(const std::string& line, int& bank) {
+    std::string word;
+    std::string argument;
+    size_t pos = 0;
+    auto nextToken = [&]() {
+        while (pos < line.size() && std::isspace(static_cast<unsigned char>(line[pos]))) pos++;
+        std::string token;
+        while (pos < line.size() && !std::isspace(static_cast<unsigned char>(line[pos]))) {
+            token += static_cast<char>(std::tolower(static_cast<unsigned char>(line[pos++])));
+        }
+        return token;
+    };
+    word = nextToken();
+    argument = nextToken();
+    if (!nextToken().empty()) return ControlCommand::None;
+
+    if (word == "bank") {
+        if (argument == "+" || argument == "next") return ControlCommand::BankNext;
+        if (argument == "-" || argument == "previous" || argument == "prev") return ControlCommand::BankPrevious;
+        char* end = nullptr;
+        long value = std::strtol(argument.c_str(), &end, 10);
+        if (argument.empty() || *end != '\0' || value < 0 || value >= CONTROL_BANK_COUNT) return ControlCommand::None;
+        bank = static_cast<int>(value);
+        return ControlCommand::Bank;
+    }
+    if (!argument.empty()) return ControlCommand::None;
+    if (word == "quit" || word == "exit") return ControlCommand::Quit;
+    if (word == "panic") return ControlCommand::Panic;
+    if (word == "stats") return ControlCommand::Stats;
+    if (word == "help") return ControlCommand::Help;
+    return ControlCommand::None;
+}
+
+// Commands that have to run on the MIDI dispatcher thread (they send MIDI), posted by the
+// control thread. The dispatcher checks pending() once per loop iteration, a single
+// relaxed load, and calls take() only when something was posted; the poster wakes it
+// through the usual dispatcher signal.
+class ControlMailbox {
+public:
+    static const uint32_t PANIC = 1u << 0;
+    static const uint32_t BANK = 1u << 1;
+
+    void postPanic() { m_pending.fetch_or(PANIC, std::memory_order_release); }
+
+    // Requests bank (wrapped to 0..CONTROL_BANK_COUNT-1) and returns it. Relative requests
+    // build on the last requested bank, so quick repeated steps are not lost.
+    int postBank(int bank) {
+        bank = ((bank % CONTROL_BANK_COUNT) + CONTROL_BANK_COUNT) % CONTROL_BANK_COUNT;
+        m_bank.store(bank, std::memory_order_relaxed);
+        m_pending.fetch_or(BANK, std::memory_order_release);
+        return bank;
+    }
+    int postBankStep(int delta) { return postBank(m_bank.load(std::memory_order_relaxed) + delta); }
+
+    // Dispatcher side
+    bool pending() const { return m_pending.load(std::memory_order_relaxed) != 0; }
+    uint32_t take() { return m_pending.exchange(0, std::memory_order_acquire); }
+    int requestedBank() const { return m_bank.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint32_t> m_pending{0};
+    std::atomic<int> m_bank{0};
+};
@@ -0,0 +1,154 @@
+#pragma once
+// ===================================================================================
+// EventRing.h - Bounded lock-free ring buffers (SPSC event ring, MPMC queue)
+// ===================================================================================
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Fixed-capacity FIFO shared by exactly one producer thread and one consumer thread.
+// push() and pop() never block or allocate; push() fails when the ring is full so the
+// caller can decide how to account for the overflow.
+//
+// The producer can also stage() several items and make them visible to the consumer
+// together with publish(), e.g. all events belonging to one input frame.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+public:
+    // Producer side
+    bool stage(const T& item) {
+        const size_t tail = m_stagedTail;
+        if (tail - m_cachedHead == Capacity) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead == Capacity) return false;
+        }
+        m_buffer[tail & (Capacity - 1)] = item;
+        m_stagedTail = tail + 1;
+        return true;
+    }
+
+    void publish() {
+        m_tail.store(m_stagedTail, std::memory_order_release);
+    }
+
+    void discardStaged() {
+        m_stagedTail = m_tail.load(std::memory_order_relaxed);
+    }
+
+    bool push(const T& item) {
+        if (!stage(item)) return false;
+        publish();
+        return true;
+    }
+
+    // Consumer side
+    bool pop(T& out) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail) return false;
+        }
+        out = m_buffer[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called concurrently with push()/pop()
+    size_t size() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    // Producer and consumer indices live on separate cache lines to avoid false sharing
+    alignas(64) std::atomic<size_t> m_tail{0};
+    size_t m_stagedTail = 0;
+    size_t m_cachedHead = 0;
+    alignas(64) std::atomic<size_t> m_head{0};
+    size_t m_cachedTail = 0;
+    alignas(64) T m_buffer[Capacity];
+};
+
+// Fixed-capacity FIFO for any number of producer and consumer threads (Vyukov's bounded
+// queue). Each cell carries a sequence number that tells producers and consumers whose
+// turn it is, so tryPush() and tryPop() neither lock nor allocate; tryPush() fails when
+// the queue is full. Items are written and read in place through a callback, so large
+// cells are never copied.
+template <typename T, size_t Capacity>
+class MpmcRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "MpmcRing capacity must be a power of two");
+
+public:
+    MpmcRing() {
+        for (size_t i = 0; i < Capacity; ++i) m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // fill(T&) writes the item into its cell
+    template <typename Fill>
+    bool tryPush(Fill&& fill) {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = m_cells[pos & (Capacity - 1)];
+            const size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    fill(cell.item);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // Full
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // consume(T&) reads the item out of its cell
+    template <typename Consume>
+    bool tryPop(Consume&& consume) {
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = m_cells[pos & (Capacity - 1)];
+            const size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    consume(cell.item);
+                    cell.sequence.store(pos + Capacity, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // Empty
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // True if the next item to pop was not (yet) published at the time of the call. Only a
+    // hint while producers are active; a consumer uses it to decide whether to sleep.
+    bool empty() const {
+        const size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        return m_cells[pos & (Capacity - 1)].sequence.load(std::memory_order_acquire) != pos + 1;
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    alignas(64) std::atomic<size_t> m_enqueuePos{0};
+    alignas(64) std::atomic<size_t> m_dequeuePos{0};
+    alignas(64) Cell m_cells[Capacity];
+};
@@ -0,0 +1,200 @@
+#pragma once
+// ===================================================================================
+// InputRecorder.h - Compact binary recording of raw input events (--record/--replay)
+// ===================================================================================
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// File layout: the 8-byte magic "JMIDIREC", one version byte, then one variable-length
+// record per event, appended in the order the input thread saw them:
+//
+//   varint   zigzag delta of the timestamp (ns) to the previous record
+//   varint   device index (position in the configuration's device list)
+//   byte     event type, bit 7 set for initial-state snapshot events
+//   varint   event code
+//   varint   zigzag event value
+//
+// Typical records are 5-8 bytes. Timestamps are CLOCK_MONOTONIC nanoseconds; deltas are
+// signed because frames from different devices can be read slightly out of order. A
+// truncated last record (e.g. after a crash) is ignored by the reader.
+struct InputRecord {
+    uint64_t timestampNs = 0;
+    uint32_t device = 0;
+    uint16_t type = 0;
+    uint16_t code = 0;
+    int32_t value = 0;
+    bool snapshot = false;
+};
+
+namespace input_record_detail {
+    constexpr char MAGIC[8] = {'J', 'M', 'I', 'D', 'I', 'R', 'E', 'C'};
+    constexpr uint8_t VERSION = 1;
+    constexpr uint8_t SNAPSHOT_FLAG = 0x80;
+
+    inline uint64_t zigzag(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+    inline int64_t unzigzag(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+}
+
+// The calling (input) thread only encodes records into a memory buffer. Every
+// FLUSH_THRESHOLD bytes the buffer is handed to a background thread that does the file
+// I/O, and an empty spare buffer takes its place, so recording never puts a disk write
+// or flush on the input path. If the disk falls behind by more than one chunk, the active
+// buffer simply keeps growing until the writer catches up.
+class InputRecordWriter {
+public:
+    bool open(const std::string& path) {
+        close();
+        m_file.open(path, std::ios::binary | std::ios::trunc);
+        if (!m_file) return false;
+        m_file.write(input_record_detail::MAGIC, sizeof(input_record_detail::MAGIC));
+        m_file.put(static_cast<char>(input_record_detail::VERSION));
+        for (auto* buffer : {&m_active, &m_pending, &m_writing}) {
+            buffer->clear();
+            buffer->reserve(FLUSH_THRESHOLD + 64);
+        }
+        m_lastTimestampNs = 0;
+        m_closing = false;
+        m_thread = std::thread(&InputRecordWriter::writerLoop, this);
+        return static_cast<bool>(m_file);
+    }
+
+    ~InputRecordWriter() { close(); }
+
+    // Encodes into an in-memory buffer; full chunks go to the writer thread
+    void write(const InputRecord& record) {
+        using namespace input_record_detail;
+        putVarint(zigzag(static_cast<int64_t>(record.timestampNs - m_lastTimestampNs)));
+        m_lastTimestampNs = record.timestampNs;
+        putVarint(record.device);
+        m_active.push_back(static_cast<uint8_t>((record.type & 0x7F) | (record.snapshot ? SNAPSHOT_FLAG : 0)));
+        putVarint(record.code);
+        putVarint(zigzag(record.value));
+        m_records++;
+        if (m_active.size() >= FLUSH_THRESHOLD) handOff();
+    }
+
+    // Writes everything recorded so far and closes the file; waits for the writer thread
+    void close() {
+        if (!m_thread.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending.insert(m_pending.end(), m_active.begin(), m_active.end());
+            m_active.clear();
+            m_closing = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+        m_file.close();
+    }
+
+    uint64_t records() const { return m_records; }
+
+private:
+    static const size_t FLUSH_THRESHOLD = 64 * 1024;
+
+    // Passes the active buffer to the writer unless it is still busy with the previous
+    // chunk. The mutex is never held during I/O, so this does not wait for the disk.
+    void handOff() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_pending.empty()) return;
+            std::swap(m_active, m_pending);
+        }
+        m_wake.notify_one();
+    }
+
+    void writerLoop() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_wake.wait(lock, [this] { return !m_pending.empty() || m_closing; });
+            if (m_pending.empty()) break;  // Closing and nothing left
+            std::swap(m_pending, m_writing);
+            lock.unlock();
+            m_file.write(reinterpret_cast<const char*>(m_writing.data()), static_cast<std::streamsize>(m_writing.size()));
+            m_file.flush();
+            m_writing.clear();
+            lock.lock();
+        }
+    }
+
+    void putVarint(uint64_t v) {
+        while (v >= 0x80) {
+            m_active.push_back(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        m_active.push_back(static_cast<uint8_t>(v));
+    }
+
+    std::ofstream m_file;                // Written by the writer thread only while it runs
+    std::vector<uint8_t> m_active;       // Being filled by the input thread
+    std::vector<uint8_t> m_pending;      // Full chunk waiting for the writer (guarded by m_mutex)
+    std::vector<uint8_t> m_writing;      // Owned by the writer thread
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_closing = false;              // Guarded by m_mutex
+    uint64_t m_lastTimestampNs = 0;
+    uint64_t m_records = 0;
+};
+
+// Reads a whole recording into memory up front so replay timing is not disturbed by I/O
+class InputRecordReader {
+public:
+    bool open(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+        m_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        const size_t headerSize = sizeof(input_record_detail::MAGIC) + 1;
+        if (m_data.size() < headerSize ||
+            memcmp(m_data.data(), input_record_detail::MAGIC, sizeof(input_record_detail::MAGIC)) != 0 ||
+            static_cast<uint8_t>(m_data[headerSize - 1]) != input_record_detail::VERSION) {
+            m_data.clear();
+            return false;
+        }
+        m_pos = headerSize;
+        m_lastTimestampNs = 0;
+        return true;
+    }
+
+    bool next(InputRecord& record) {
+        using namespace input_record_detail;
+        uint64_t delta, device, code, value;
+        size_t pos = m_pos;
+        if (!getVarint(pos, delta) || !getVarint(pos, device) || pos >= m_data.size()) return false;
+        uint8_t type = static_cast<uint8_t>(m_data[pos++]);
+        if (!getVarint(pos, code) || !getVarint(pos, value)) return false;
+        m_pos = pos;
+        m_lastTimestampNs += static_cast<uint64_t>(unzigzag(delta));
+        record.timestampNs = m_lastTimestampNs;
+        record.device = static_cast<uint32_t>(device);
+        record.type = type & 0x7F;
+        record.snapshot = (type & SNAPSHOT_FLAG) != 0;
+        record.code = static_cast<uint16_t>(code);
+        record.value = static_cast<int32_t>(unzigzag(value));
+        return true;
+    }
+
+private:
+    bool getVarint(size_t& pos, uint64_t& out) const {
+        out = 0;
+        for (unsigned shift = 0; shift < 64 && pos < m_data.size(); shift += 7) {
+            uint8_t byte = static_cast<uint8_t>(m_data[pos++]);
+            out |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    std::vector<char> m_data;
+    size_t m_pos = 0;
+    uint64_t m_lastTimestampNs = 0;
+};
@@ -0,0 +1,85 @@
+#pragma once
+// ===================================================================================
+// InputSource.h - Input source abstraction and a synthetic load source
+// ===================================================================================
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "MappingEngine.h"
+
+// Producer of control values for the mapping engine. run() executes on the input thread
+// and publishes frames (engine.publish() ... engine.commitFrame()) until quit is set or
+// the source is exhausted. Live devices (evdev, Windows raw input), recordings and the
+// synthetic source below all implement it.
+class InputSource {
+public:
+    virtual ~InputSource() = default;
+    virtual const char* sourceName() const = 0;
+    virtual void run(MappingEngine& engine, const std::atomic<bool>& quit) = 0;
+};
+
+// Deterministic synthetic input: frameCount frames, each changing eventsPerFrame mappings
+// chosen round-robin. Axes sweep across their calibrated range and buttons toggle, so
+// every event is a real change. With a frame interval the frames are paced like a device
+// (e.g. 1 ms for a 1 kHz controller); with zero they are produced as fast as possible.
+// dispatchInline drains the engine after every frame on the same thread, which measures
+// the complete input-to-MIDI path without thread hand-off.
+class SyntheticInputSource : public InputSource {
+public:
+    SyntheticInputSource(uint64_t frameCount, size_t eventsPerFrame,
+                         std::chrono::nanoseconds frameInterval = std::chrono::nanoseconds(0),
+                         bool dispatchInline = false)
+        : m_frameCount(frameCount), m_eventsPerFrame(eventsPerFrame),
+          m_frameInterval(frameInterval), m_dispatchInline(dispatchInline) {}
+
+    const char* sourceName() const override { return "synthetic"; }
+
+    void run(MappingEngine& engine, const std::atomic<bool>& quit) override {
+        const auto& states = engine.states();
+        const size_t mappingCount = states.size();
+        if (mappingCount == 0) return;
+
+        size_t next = 0;
+        auto due = std::chrono::steady_clock::now();
+        for (uint64_t frame = 0; frame < m_frameCount && !quit.load(std::memory_order_relaxed); ++frame) {
+            if (m_frameInterval.count() > 0) {
+                due += m_frameInterval;
+                std::this_thread::sleep_until(due);
+            }
+            bool anyChanged = false;
+            for (size_t e = 0; e < m_eventsPerFrame; ++e) {
+                const size_t i = next;
+                next = (next + 1) % mappingCount;
+                if (engine.publish(i, nextValue(engine, i, frame))) anyChanged = true;
+            }
+            engine.commitFrame(anyChanged);
+            if (m_dispatchInline) engine.dispatch();
+        }
+    }
+
+    uint64_t frameCount() const { return m_frameCount; }
+    size_t eventsPerFrame() const { return m_eventsPerFrame; }
+
+private:
+    static LONG nextValue(MappingEngine& engine, size_t i, uint64_t frame) {
+        LONG current = engine.states()[i].currentValue.load(std::memory_order_relaxed);
+        const ControlMapping& mapping = engine.mappingAt(i);
+        if (mapping.control.isButton) return current ? 0 : 1;
+        LONG lo = mapping.calibrationDone ? mapping.calibrationMinHid : mapping.control.logicalMin;
+        LONG hi = mapping.calibrationDone ? mapping.calibrationMaxHid : mapping.control.logicalMax;
+        if (hi <= lo) return current + 1;
+        // Triangle sweep with a step of ~1/256 of the range per visit
+        const uint64_t span = static_cast<uint64_t>(hi - lo);
+        const uint64_t step = std::max<uint64_t>(1, span / 256);
+        const uint64_t pos = (frame * step) % (2 * span);
+        return lo + static_cast<LONG>(pos <= span ? pos : 2 * span - pos);
+    }
+
+    uint64_t m_frameCount;
+    size_t m_eventsPerFrame;
+    std::chrono::nanoseconds m_frameInterval;
+    bool m_dispatchInline;
+};
@@ -0,0 +1,80 @@
+#pragma once
+// ===================================================================================
+// LatencyHistogram.h - Fixed-memory log-linear latency histogram (HDR-style)
+// ===================================================================================
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Records nanosecond durations into log-linear buckets: exact below 64 ns, then 32
+// sub-buckets per power of two (about 3% relative precision) up to ~18 minutes.
+// record() never allocates or locks. One thread records; any thread may read, and
+// readers see a slightly stale but consistent-enough view for reporting.
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BITS = 5;
+    static constexpr uint64_t SUB_COUNT = 1ull << SUB_BITS;
+    static constexpr unsigned MAX_MAGNITUDE = 40;  // 2^40 ns
+    static constexpr size_t BUCKET_COUNT = 2 * SUB_COUNT + (MAX_MAGNITUDE - SUB_BITS - 1) * SUB_COUNT;
+
+    void record(uint64_t valueNs) {
+        const size_t index = bucketFor(valueNs);
+        m_counts[index].store(m_counts[index].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        m_total.store(m_total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (valueNs > m_max.load(std::memory_order_relaxed)) m_max.store(valueNs, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return m_total.load(std::memory_order_relaxed); }
+    uint64_t max() const { return m_max.load(std::memory_order_relaxed); }
+
+    // Highest value equivalent to the bucket holding the given quantile (0.0 - 1.0)
+    uint64_t percentile(double quantile) const {
+        const uint64_t total = count();
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(total) + 0.5);
+        rank = std::max<uint64_t>(1, std::min(rank, total));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += m_counts[i].load(std::memory_order_relaxed);
+            if (seen >= rank) return std::min(bucketUpperBound(i), max());
+        }
+        return max();
+    }
+
+private:
+    static size_t bucketFor(uint64_t value) {
+        if (value < 2 * SUB_COUNT) return static_cast<size_t>(value);
+        const unsigned magnitude = highestBit(value);
+        if (magnitude >= MAX_MAGNITUDE) return BUCKET_COUNT - 1;
+        const uint64_t sub = (value >> (magnitude - SUB_BITS)) & (SUB_COUNT - 1);
+        return static_cast<size_t>(2 * SUB_COUNT + (magnitude - SUB_BITS - 1) * SUB_COUNT + sub);
+    }
+
+    static unsigned highestBit(uint64_t value) {
+#ifdef _MSC_VER
+        unsigned long bit;
+        _BitScanReverse64(&bit, value);
+        return static_cast<unsigned>(bit);
+#else
+        return 63 - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+    }
+
+    static uint64_t bucketUpperBound(size_t index) {
+        if (index < 2 * SUB_COUNT) return index;
+        const size_t offset = index - 2 * SUB_COUNT;
+        const unsigned magnitude = static_cast<unsigned>(offset / SUB_COUNT) + SUB_BITS + 1;
+        const uint64_t sub = offset % SUB_COUNT;
+        const uint64_t width = 1ull << (magnitude - SUB_BITS);
+        return (1ull << magnitude) + sub * width + width - 1;
+    }
+
+    std::atomic<uint64_t> m_counts[BUCKET_COUNT] = {};
+    std::atomic<uint64_t> m_total{0};
+    std::atomic<uint64_t> m_max{0};
+};
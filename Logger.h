@@ -1,9 +1,9 @@
 #pragma once
 // ===================================================================================
-// Logger.h - Simple file-based logger with level filtering and auto-rotation
+// Logger.h - Asynchronous file-based logger with level filtering, rotation and retention
 // ===================================================================================
 
-#include <fstream>
+#include <filesystem>
 #include <mutex>
 #include <string>
 #include <chrono>
@@ -11,7 +11,22 @@
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "EventRing.h"
 
 // Undefine ERROR if defined by Windows headers to avoid conflict
 #ifdef ERROR
@@ -20,80 +35,133 @@
 
 enum class LogLevel { DEBUG = 0, INFO = 1, WARN = 2, ERR = 3, NONE = 4 };
 
+// Lowest level compiled into the binary (0 = DEBUG ... 3 = ERROR, 4 = none). LOG_* macros
+// below it become dead code the compiler removes, arguments included; set it with the
+// JOYSTICKMIDI_LOG_MIN_LEVEL CMake option.
+#ifndef JOYSTICKMIDI_LOG_MIN_LEVEL
+#define JOYSTICKMIDI_LOG_MIN_LEVEL 0
+#endif
+
+// Where log files go and how many are kept. Files are named joystickmidi_<timestamp>.log;
+// a new file starts when the current one reaches maxFileBytes or maxFileAge (0 = no limit),
+// and, when maxFiles / maxTotalBytes is set, the oldest joystickmidi_*.log files in the
+// directory beyond the limit are deleted, whichever run wrote them. Both default to keeping all.
+struct LogOptions {
+    std::string directory = ".";
+    uint64_t maxFileBytes = 8ull * 1024 * 1024;
+    std::chrono::seconds maxFileAge{0};
+    size_t maxFiles = 0;           // Including the current file
+    uint64_t maxTotalBytes = 0;
+};
+
+// log() copies the message and its wall-clock time into a bounded lock-free queue and
+// returns; a background thread formats the records and writes them to the file in batches.
+// Logging therefore never waits for the disk or a lock. When the queue is full the message
+// is dropped and counted, and the writer reports the number of dropped messages in the log.
+// Multi-line messages become one record per line; a line longer than MAX_MESSAGE_LENGTH
+// is cut and counted the same way. The idle writer sleeps without a timeout and is woken
+// by the message that makes the queue non-empty. Rotation, preallocation and deleting old
+// files also happen on the writer thread.
 class Logger {
 public:
-    static Logger& instance() {
-        static Logger inst;
-        return inst;
+    static const size_t QUEUE_CAPACITY = 4096;
+    static const size_t MAX_MESSAGE_LENGTH = 240;  // Per line; longer lines are truncated
+
+    // A static member rather than a function-local static, so instance() is a plain
+    // address with no initialization guard on every logging call
+    static Logger& instance() { return s_instance; }
+
+    static constexpr bool isCompiledIn(LogLevel level) {
+        return static_cast<int>(level) >= JOYSTICKMIDI_LOG_MIN_LEVEL;
     }
 
     // Initialize logger with level string (e.g., "DEBUG", "INFO", "WARN", "ERROR")
     // Logs at the specified level and above
-    void init(const std::string& levelArg) {
-        std::lock_guard<std::mutex> lock(m_mutex);
+    void init(const std::string& levelArg, const LogOptions& options = LogOptions()) {
+        std::lock_guard<std::mutex> lock(m_controlMutex);
+        stopWriter();
 
         // Parse level
         std::string level = levelArg;
         std::transform(level.begin(), level.end(), level.begin(),
                        [](unsigned char c) { return std::toupper(c); });
 
+        LogLevel minLevel;
         if (level == "DEBUG") {
-            m_minLevel = LogLevel::DEBUG;
+            minLevel = LogLevel::DEBUG;
         } else if (level == "INFO") {
-            m_minLevel = LogLevel::INFO;
+            minLevel = LogLevel::INFO;
         } else if (level == "WARN" || level == "WARNING") {
-            m_minLevel = LogLevel::WARN;
+            minLevel = LogLevel::WARN;
         } else if (level == "ERROR" || level == "ERR") {
-            m_minLevel = LogLevel::ERR;
+            minLevel = LogLevel::ERR;
         } else {
             // Invalid level, disable logging
-            m_minLevel = LogLevel::NONE;
+            m_threshold.store(static_cast<int>(LogLevel::NONE), std::memory_order_release);
             return;
         }
 
         // Create log file with timestamp
+        if (!m_queue) m_queue = std::make_unique<Queue>();
+        closeLogFile();
+        m_options = options;
+        std::error_code ec;
+        if (m_options.directory.empty()) m_options.directory = ".";
+        std::filesystem::create_directories(m_options.directory, ec);
         openNewLogFile();
         m_initialized = true;
+        m_threshold.store(static_cast<int>(minLevel), std::memory_order_release);
 
         // Log startup
-        logInternal(LogLevel::INFO, "Logger initialized at level: " + levelArg);
+        writeRecord(WallClockNs(), LogLevel::INFO, "Logger initialized at level: " + levelArg);
+        m_running = true;
+        m_writer = std::thread(&Logger::writerLoop, this);
     }
 
     void log(LogLevel level, const std::string& message) {
-        if (!m_initialized || level < m_minLevel || level == LogLevel::NONE) {
-            return;
-        }
-
-        std::lock_guard<std::mutex> lock(m_mutex);
-
-        // Check if we need to rotate (3 minutes = 180 seconds)
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - m_fileStartTime).count();
-        if (elapsed >= 180) {
-            logInternal(LogLevel::INFO, "Log rotation: creating new file after 3 minutes");
-            m_file.close();
-            openNewLogFile();
-        }
+        log(level, message.data(), message.size());
+    }
 
-        logInternal(level, message);
+    // Never blocks: each line is queued for the writer thread or dropped if the queue is full
+    void log(LogLevel level, const char* text, size_t length) {
+        if (!isLevelEnabled(level)) return;
+        const int64_t wallNs = WallClockNs();
+        const char* end = text + length;
+        do {
+            const char* newline = static_cast<const char*>(memchr(text, '\n', static_cast<size_t>(end - text)));
+            const char* lineEnd = newline ? newline : end;
+            if (newline && lineEnd == text && newline + 1 == end) break;  // Trailing newline
+            pushLine(level, wallNs, text, static_cast<size_t>(lineEnd - text));
+            text = newline ? newline + 1 : end;
+        } while (text < end);
+        wakeWriter();
     }
 
     bool isEnabled() const {
-        return m_initialized && m_minLevel != LogLevel::NONE;
+        return m_threshold.load(std::memory_order_relaxed) != static_cast<int>(LogLevel::NONE);
     }
 
+    // One relaxed load: the threshold is NONE until init() and after shutdown()
     bool isLevelEnabled(LogLevel level) const {
-        return m_initialized && level >= m_minLevel && level != LogLevel::NONE;
+        return static_cast<int>(level) >= m_threshold.load(std::memory_order_relaxed) && level != LogLevel::NONE;
     }
 
-    // Shutdown logger cleanly
+    // Messages dropped because the queue was full, since the process started
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    // Lines cut to MAX_MESSAGE_LENGTH, since the process started
+    uint64_t truncated() const { return m_truncated.load(std::memory_order_relaxed); }
+
+    // Shutdown logger cleanly: everything queued so far is written before the file closes
     void shutdown() {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        if (m_initialized && m_file.is_open()) {
-            logInternal(LogLevel::INFO, "Logger shutting down");
-            m_file.close();
-        }
+        std::lock_guard<std::mutex> lock(m_controlMutex);
+        if (!m_initialized) return;
         m_initialized = false;
+        m_threshold.store(static_cast<int>(LogLevel::NONE), std::memory_order_release);
+        stopWriter();
+        if (m_file) {
+            writeRecord(WallClockNs(), LogLevel::INFO, "Logger shutting down");
+            closeLogFile();
+        }
     }
 
     ~Logger() {
@@ -101,10 +169,53 @@ public:
     }
 
 private:
+    struct LogRecord {
+        int64_t wallNs = 0;
+        LogLevel level = LogLevel::INFO;
+        uint16_t length = 0;
+        char text[MAX_MESSAGE_LENGTH];
+    };
+    using Queue = MpmcRing<LogRecord, QUEUE_CAPACITY>;
+
+    static constexpr size_t MAX_BATCH_BYTES = 64 * 1024;
+
     Logger() = default;
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
 
+    void pushLine(LogLevel level, int64_t wallNs, const char* text, size_t length) {
+        const bool queued = m_queue->tryPush([&](LogRecord& record) {
+            record.wallNs = wallNs;
+            record.level = level;
+            if (length > MAX_MESSAGE_LENGTH) {
+                memcpy(record.text, text, MAX_MESSAGE_LENGTH - 3);
+                memcpy(record.text + MAX_MESSAGE_LENGTH - 3, "...", 3);
+                length = MAX_MESSAGE_LENGTH;
+                m_truncated.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                memcpy(record.text, text, length);
+            }
+            record.length = static_cast<uint16_t>(length);
+        });
+        if (!queued) m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Wakes the writer if it went to sleep on an empty queue. The fence pairs with the one
+    // in writerLoop(): either the writer sees the new record before sleeping, or this sees
+    // m_writerSleeping and exactly one producer takes the notify.
+    void wakeWriter() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!m_writerSleeping.load(std::memory_order_relaxed)) return;
+        if (!m_writerSleeping.exchange(false, std::memory_order_acq_rel)) return;
+        { std::lock_guard<std::mutex> lock(m_wakeMutex); }
+        m_wake.notify_one();
+    }
+
+    static int64_t WallClockNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
     void openNewLogFile() {
         auto now = std::chrono::system_clock::now();
         auto time_t_now = std::chrono::system_clock::to_time_t(now);
@@ -115,37 +226,206 @@ private:
         localtime_r(&time_t_now, &tm_now);
 #endif
 
-        std::ostringstream filename;
-        filename << "joystickmidi_"
-                 << std::put_time(&tm_now, "%Y-%m-%d_%H-%M-%S")
-                 << ".log";
+        std::ostringstream stem;
+        stem << LOG_FILE_PREFIX << std::put_time(&tm_now, "%Y-%m-%d_%H-%M-%S");
 
-        m_file.open(filename.str(), std::ios::out | std::ios::app);
+        // Size-based rotation can start several files within one second; they get a
+        // zero-padded sequence number so names keep sorting in creation order
+        namespace fs = std::filesystem;
+        if (stem.str() != m_lastStem) {
+            m_lastStem = stem.str();
+            m_stemSequence = 0;
+        }
+        fs::path path;
+        std::error_code ec;
+        do {
+            char suffix[16] = "";
+            if (m_stemSequence > 0) std::snprintf(suffix, sizeof(suffix), "_%03u", m_stemSequence);
+            path = fs::path(m_options.directory) / (m_lastStem + suffix + LOG_FILE_SUFFIX);
+            m_stemSequence++;
+        } while (fs::exists(path, ec) && m_stemSequence < 1000);
+
+        m_file = std::fopen(path.string().c_str(), "ab");
+        m_fileBytes = 0;
         m_fileStartTime = std::chrono::steady_clock::now();
-        m_currentFilename = filename.str();
+        m_currentFilename = path.string();
+#ifdef __linux__
+        // Reserve the blocks for a full file up front (without changing its size), so
+        // appends do not allocate on the way and the file stays contiguous
+        if (m_file && m_options.maxFileBytes > 0) {
+            fallocate(fileno(m_file), FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(m_options.maxFileBytes));
+        }
+#endif
+        enforceRetention();
     }
 
-    void logInternal(LogLevel level, const std::string& message) {
-        if (!m_file.is_open()) return;
+    void closeLogFile() {
+        if (!m_file) return;
+        std::fflush(m_file);
+#ifdef __linux__
+        // Trim the unused part of the preallocation (best effort)
+        const long size = std::ftell(m_file);
+        if (m_options.maxFileBytes > 0 && size >= 0) {
+            int rc = ftruncate(fileno(m_file), static_cast<off_t>(size));
+            (void)rc;
+        }
+#endif
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
 
-        auto now = std::chrono::system_clock::now();
-        auto time_t_now = std::chrono::system_clock::to_time_t(now);
-        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now.time_since_epoch()) % 1000;
+    // Deletes the oldest log files in the directory beyond the file-count and byte caps.
+    // Timestamped names sort chronologically; the current file is always kept.
+    void enforceRetention() {
+        if (m_options.maxFiles == 0 && m_options.maxTotalBytes == 0) return;
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        std::vector<fs::path> files;
+        for (fs::directory_iterator it(m_options.directory, ec), end; !ec && it != end; it.increment(ec)) {
+            const std::string name = it->path().filename().string();
+            if (name.size() > strlen(LOG_FILE_PREFIX) + strlen(LOG_FILE_SUFFIX) &&
+                name.compare(0, strlen(LOG_FILE_PREFIX), LOG_FILE_PREFIX) == 0 &&
+                name.compare(name.size() - strlen(LOG_FILE_SUFFIX), std::string::npos, LOG_FILE_SUFFIX) == 0 &&
+                it->path().string() != m_currentFilename) {
+                files.push_back(it->path());
+            }
+        }
+        std::sort(files.begin(), files.end(), [](const fs::path& a, const fs::path& b) { return a > b; });  // Newest first
+
+        size_t keptFiles = 1;  // The current file, which may grow to maxFileBytes
+        uint64_t keptBytes = m_options.maxFileBytes;
+        for (const auto& file : files) {
+            const uint64_t size = fs::file_size(file, ec);
+            const bool overCount = m_options.maxFiles > 0 && keptFiles >= m_options.maxFiles;
+            const bool overBytes = m_options.maxTotalBytes > 0 && keptBytes + (ec ? 0 : size) > m_options.maxTotalBytes;
+            if (overCount || overBytes) {
+                fs::remove(file, ec);
+            } else {
+                keptFiles++;
+                keptBytes += ec ? 0 : size;
+            }
+        }
+    }
 
-        std::tm tm_now;
+    // Writer thread: drains the queue into one buffer per pass and writes it with a single
+    // flush. Rotation happens here too, so no logging thread ever touches the file.
+    void writerLoop() {
+        uint64_t reportedDrops = m_dropped.load(std::memory_order_relaxed);
+        uint64_t reportedTruncations = m_truncated.load(std::memory_order_relaxed);
+        for (;;) {
+            const bool stopping = !m_running.load(std::memory_order_acquire);
+            m_batch.clear();
+            size_t drained = 0;
+            while (drained < QUEUE_CAPACITY && m_queue->tryPop([&](LogRecord& record) {
+                       appendRecord(m_batch, record.wallNs, record.level, record.text, record.length);
+                   })) {
+                drained++;
+                // Large backlogs go out in chunks so the size limit is honoured
+                if (m_batch.size() >= batchLimit()) {
+                    rotateIfDue(m_batch.size());
+                    writeBatch(m_batch);
+                    m_batch.clear();
+                }
+            }
+            const uint64_t drops = m_dropped.load(std::memory_order_relaxed);
+            if (drops != reportedDrops) {
+                std::string note = std::to_string(drops - reportedDrops) + " log message(s) dropped (queue full)";
+                appendRecord(m_batch, WallClockNs(), LogLevel::WARN, note.data(), note.size());
+                reportedDrops = drops;
+            }
+            const uint64_t truncations = m_truncated.load(std::memory_order_relaxed);
+            if (truncations != reportedTruncations) {
+                std::string note = std::to_string(truncations - reportedTruncations) + " log line(s) truncated to " +
+                                   std::to_string(MAX_MESSAGE_LENGTH) + " characters";
+                appendRecord(m_batch, WallClockNs(), LogLevel::WARN, note.data(), note.size());
+                reportedTruncations = truncations;
+            }
+            if (!m_batch.empty()) {
+                rotateIfDue(m_batch.size());
+                writeBatch(m_batch);
+            }
+            if (stopping) break;
+            if (drained == 0) {
+                // Announce the sleep, then look at the queue once more (see wakeWriter())
+                m_writerSleeping.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (!m_queue->empty()) {
+                    m_writerSleeping.store(false, std::memory_order_relaxed);
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(m_wakeMutex);
+                m_wake.wait(lock, [this] { return !m_writerSleeping.load() || !m_running.load(); });
+                m_writerSleeping.store(false, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void stopWriter() {
+        if (!m_writer.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_running = false;
+        }
+        m_wake.notify_one();
+        m_writer.join();
+    }
+
+    // Starts a new file before a write that would exceed the size limit, or once the
+    // current file is older than the age limit
+    void rotateIfDue(size_t pendingBytes) {
+        if (!m_file) return;
+        const char* reason = nullptr;
+        if (m_options.maxFileBytes > 0 && m_fileBytes > 0 && m_fileBytes + pendingBytes > m_options.maxFileBytes) {
+            reason = "size limit reached";
+        } else if (m_options.maxFileAge.count() > 0 &&
+                   std::chrono::steady_clock::now() - m_fileStartTime >= m_options.maxFileAge) {
+            reason = "age limit reached";
+        }
+        if (!reason) return;
+        const std::string previous = m_currentFilename;
+        writeRecord(WallClockNs(), LogLevel::INFO, std::string("Log rotation: ") + reason);
+        closeLogFile();
+        openNewLogFile();
+        writeRecord(WallClockNs(), LogLevel::INFO, "Log rotation: continued from " + previous);
+    }
+
+    size_t batchLimit() const {
+        const uint64_t limit = m_options.maxFileBytes > 0 ? m_options.maxFileBytes / 8 : MAX_BATCH_BYTES;
+        return static_cast<size_t>(std::max<uint64_t>(4096, std::min<uint64_t>(limit, MAX_BATCH_BYTES)));
+    }
+
+    void writeBatch(const std::string& data) {
+        if (!m_file) return;
+        m_fileBytes += std::fwrite(data.data(), 1, data.size(), m_file);
+        std::fflush(m_file);
+    }
+
+    // Only used while the writer thread is not running (init, shutdown) or by it
+    void writeRecord(int64_t wallNs, LogLevel level, const std::string& message) {
+        std::string line;
+        appendRecord(line, wallNs, level, message.data(), message.size());
+        writeBatch(line);
+    }
+
+    // "[YYYY-MM-DD HH:MM:SS.mmm] [LEVEL] message\n"; localtime runs once per second
+    void appendRecord(std::string& out, int64_t wallNs, LogLevel level, const char* text, size_t length) {
+        const std::time_t seconds = static_cast<std::time_t>(wallNs / 1000000000);
+        if (seconds != m_stampSecond) {
+            std::tm tm_now;
 #ifdef _WIN32
-        localtime_s(&tm_now, &time_t_now);
+            localtime_s(&tm_now, &seconds);
 #else
-        localtime_r(&time_t_now, &tm_now);
+            localtime_r(&seconds, &tm_now);
 #endif
-
-        m_file << "[" << std::put_time(&tm_now, "%Y-%m-%d %H:%M:%S")
-               << "." << std::setfill('0') << std::setw(3) << ms.count() << "] "
-               << "[" << std::setw(5) << std::left << levelToString(level) << "] "
-               << message << std::endl;
-
-        m_file.flush();
+            std::strftime(m_stamp, sizeof(m_stamp), "%Y-%m-%d %H:%M:%S", &tm_now);
+            m_stampSecond = seconds;
+        }
+        char prefix[64];
+        int n = std::snprintf(prefix, sizeof(prefix), "[%s.%03d] [%-5s] ", m_stamp,
+                              static_cast<int>((wallNs / 1000000) % 1000), levelToString(level));
+        out.append(prefix, static_cast<size_t>(std::max(0, n)));
+        out.append(text, length);
+        out.push_back('\n');
     }
 
     static const char* levelToString(LogLevel level) {
@@ -158,27 +438,62 @@ private:
         }
     }
 
-    std::ofstream m_file;
-    std::mutex m_mutex;
-    LogLevel m_minLevel = LogLevel::NONE;
+    static Logger s_instance;
+
+    // Shared with logging threads
+    std::atomic<int> m_threshold{static_cast<int>(LogLevel::NONE)};  // Lowest enabled level
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_truncated{0};
+    std::atomic<bool> m_writerSleeping{false};  // Writer is (about to be) blocked on m_wake
+    std::unique_ptr<Queue> m_queue;
+
+    // Writer thread
+    std::thread m_writer;
+    std::atomic<bool> m_running{false};
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::mutex m_controlMutex;  // Serializes init() and shutdown()
     bool m_initialized = false;
+
+    static constexpr const char* LOG_FILE_PREFIX = "joystickmidi_";
+    static constexpr const char* LOG_FILE_SUFFIX = ".log";
+
+    // Owned by the writer thread while it runs
+    LogOptions m_options;
+    std::FILE* m_file = nullptr;
+    uint64_t m_fileBytes = 0;
+    std::string m_lastStem;
+    unsigned m_stemSequence = 0;
+    std::string m_batch;
+    std::time_t m_stampSecond = -1;
+    char m_stamp[32] = {0};
     std::chrono::steady_clock::time_point m_fileStartTime;
     std::string m_currentFilename;
 };
 
+inline Logger Logger::s_instance;
+
 // ===================================================================================
 // Logging Macros - Use these throughout the codebase
 // ===================================================================================
 
+// Level checks come first, so a disabled level costs one load and compare and never builds
+// the message; levels below JOYSTICKMIDI_LOG_MIN_LEVEL are removed at compile time.
+#define LOG_AT(level, msg) do { \
+    if (Logger::isCompiledIn(level) && Logger::instance().isLevelEnabled(level)) { \
+        Logger::instance().log(level, msg); \
+    } \
+} while(0)
+
 // Simple string logging
-#define LOG_DEBUG(msg) Logger::instance().log(LogLevel::DEBUG, msg)
-#define LOG_INFO(msg)  Logger::instance().log(LogLevel::INFO, msg)
-#define LOG_WARN(msg)  Logger::instance().log(LogLevel::WARN, msg)
-#define LOG_ERROR(msg) Logger::instance().log(LogLevel::ERR, msg)
+#define LOG_DEBUG(msg) LOG_AT(LogLevel::DEBUG, msg)
+#define LOG_INFO(msg)  LOG_AT(LogLevel::INFO, msg)
+#define LOG_WARN(msg)  LOG_AT(LogLevel::WARN, msg)
+#define LOG_ERROR(msg) LOG_AT(LogLevel::ERR, msg)
 
 // Stream-style logging helper
 #define LOG_STREAM(level, expr) do { \
-    if (Logger::instance().isLevelEnabled(level)) { \
+    if (Logger::isCompiledIn(level) && Logger::instance().isLevelEnabled(level)) { \
         std::ostringstream _log_ss; \
         _log_ss << expr; \
         Logger::instance().log(level, _log_ss.str()); \
@@ -0,0 +1,244 @@
+#pragma once
+// ===================================================================================
+// MappingConfig.h - Mapping configuration data structures and JSON serialization
+// ===================================================================================
+
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+    #define NOMINMAX
+    #endif
+    #include <windows.h>
+    #include <hidsdi.h>
+#else
+    #include <cstdint>
+    // Define LONG for Linux to match the Windows type used in shared code
+    typedef int32_t LONG;
+#endif
+
+#include "third_party/nlohmann/json.hpp"
+
+// --- Data Structures ---
+struct ControlInfo {
+    size_t deviceIndex = 0;  // Index into MidiMappingConfig::devices
+    bool isButton = false;
+    LONG logicalMin = 0;
+    LONG logicalMax = 0;
+    std::string name = "Unknown Control";
+
+#ifdef _WIN32
+    USAGE usagePage = 0;
+    USAGE usage = 0;
+#else // Linux
+    uint16_t eventType = 0;
+    uint16_t eventCode = 0;
+#endif
+};
+
+enum class MidiMessageType { NONE, NOTE_ON_OFF, CC };
+
+struct ControlMapping {
+    ControlInfo control;
+    MidiMessageType midiMessageType = MidiMessageType::NONE;
+    int midiChannel = -1;  // -1 means use default channel
+    int midiNoteOrCCNumber = 0;
+    int midiValueNoteOnVelocity = 64;
+    int midiValueCCOn = 127;
+    int midiValueCCOff = 0;
+    LONG calibrationMinHid = 0;
+    LONG calibrationMaxHid = 0;
+    bool calibrationDone = false;
+    bool reverseAxis = false;
+};
+
+// Identifiers that survive reboots and USB re-enumeration, unlike /dev/input/eventN (Linux)
+struct DeviceIdentity {
+    std::string vendorId;   // ID_VENDOR_ID, 4 hex digits
+    std::string productId;  // ID_MODEL_ID, 4 hex digits
+    std::string serial;     // ID_SERIAL
+    std::string byIdPath;   // /dev/input/by-id/... symlink
+    std::string phys;       // Physical topology path (e.g. usb-0000:00:14.0-2/input0)
+
+    bool empty() const { return vendorId.empty() && productId.empty(); }
+};
+
+struct InputDeviceConfig {
+    std::string path;  // Last known device node
+    std::string name;
+    DeviceIdentity identity;
+};
+
+// Scheduling of the input thread and the MIDI dispatch thread. A thread runs real-time
+// (SCHED_FIFO or SCHED_RR on Linux, time-critical priority on Windows) when its priority
+// is above 0; a CPU of -1 leaves it unpinned.
+struct RealtimeConfig {
+    std::string policy = "fifo";  // "fifo" or "rr"
+    int inputPriority = 0;        // 1-99
+    int midiPriority = 0;
+    int inputCpu = -1;
+    int midiCpu = -1;
+    bool lockMemory = false;      // mlockall() and prefault the real-time threads' stacks
+
+    bool isDefault() const {
+        return policy == "fifo" && inputPriority == 0 && midiPriority == 0 && inputCpu < 0 && midiCpu < 0 &&
+               !lockMemory;
+    }
+};
+
+struct MidiMappingConfig {
+    std::vector<InputDeviceConfig> devices;  // First entry is the primary device
+    std::string midiDeviceName;
+    int defaultMidiChannel = 0;
+    int midiSendIntervalMs = 1;
+    std::vector<ControlMapping> mappings;
+    RealtimeConfig realtime;
+};
+
+// --- JSON Serialization ---
+using json = nlohmann::json;
+
+NLOHMANN_JSON_SERIALIZE_ENUM(MidiMessageType, {
+    {MidiMessageType::NONE, nullptr},
+    {MidiMessageType::NOTE_ON_OFF, "NoteOnOff"},
+    {MidiMessageType::CC, "CC"}
+})
+
+inline void to_json(json& j, const ControlInfo& ctrl) {
+    j = json{
+        {"device", ctrl.deviceIndex},
+        {"isButton", ctrl.isButton}, {"logicalMin", ctrl.logicalMin},
+        {"logicalMax", ctrl.logicalMax}, {"name", ctrl.name}
+    };
+#ifdef _WIN32
+    j["usagePage"] = ctrl.usagePage;
+    j["usage"] = ctrl.usage;
+#else
+    j["eventType"] = ctrl.eventType;
+    j["eventCode"] = ctrl.eventCode;
+#endif
+}
+
+inline void from_json(const json& j, ControlInfo& ctrl) {
+    ctrl.deviceIndex = j.value("device", static_cast<size_t>(0));
+    j.at("isButton").get_to(ctrl.isButton);
+    j.at("logicalMin").get_to(ctrl.logicalMin);
+    j.at("logicalMax").get_to(ctrl.logicalMax);
+    j.at("name").get_to(ctrl.name);
+#ifdef _WIN32
+    ctrl.usagePage = j.value("usagePage", 0);
+    ctrl.usage = j.value("usage", 0);
+#else
+    ctrl.eventType = j.value("eventType", 0);
+    ctrl.eventCode = j.value("eventCode", 0);
+#endif
+}
+
+inline void to_json(json& j, const ControlMapping& mapping) {
+    j = json{
+        {"control", mapping.control},
+        {"midiMessageType", mapping.midiMessageType},
+        {"midiChannel", mapping.midiChannel},
+        {"midiNoteOrCCNumber", mapping.midiNoteOrCCNumber},
+        {"midiValueNoteOnVelocity", mapping.midiValueNoteOnVelocity},
+        {"midiValueCCOn", mapping.midiValueCCOn},
+        {"midiValueCCOff", mapping.midiValueCCOff},
+        {"calibrationMinHid", mapping.calibrationMinHid},
+        {"calibrationMaxHid", mapping.calibrationMaxHid},
+        {"calibrationDone", mapping.calibrationDone},
+        {"reverseAxis", mapping.reverseAxis}
+    };
+}
+
+inline void from_json(const json& j, ControlMapping& mapping) {
+    j.at("control").get_to(mapping.control);
+    j.at("midiMessageType").get_to(mapping.midiMessageType);
+    mapping.midiChannel = j.value("midiChannel", -1);
+    j.at("midiNoteOrCCNumber").get_to(mapping.midiNoteOrCCNumber);
+    mapping.midiValueNoteOnVelocity = j.value("midiValueNoteOnVelocity", 64);
+    mapping.midiValueCCOn = j.value("midiValueCCOn", 127);
+    mapping.midiValueCCOff = j.value("midiValueCCOff", 0);
+    mapping.calibrationMinHid = j.value("calibrationMinHid", 0);
+    mapping.calibrationMaxHid = j.value("calibrationMaxHid", 0);
+    mapping.calibrationDone = j.value("calibrationDone", false);
+    mapping.reverseAxis = j.value("reverseAxis", false);
+}
+
+inline void to_json(json& j, const InputDeviceConfig& dev) {
+    j = json{{"path", dev.path}, {"name", dev.name}};
+    if (!dev.identity.empty()) {
+        j["vendorId"] = dev.identity.vendorId;
+        j["productId"] = dev.identity.productId;
+        j["serial"] = dev.identity.serial;
+        j["byIdPath"] = dev.identity.byIdPath;
+        j["phys"] = dev.identity.phys;
+    }
+}
+
+inline void from_json(const json& j, InputDeviceConfig& dev) {
+    j.at("path").get_to(dev.path);
+    dev.name = j.value("name", std::string());
+    dev.identity.vendorId = j.value("vendorId", std::string());
+    dev.identity.productId = j.value("productId", std::string());
+    dev.identity.serial = j.value("serial", std::string());
+    dev.identity.byIdPath = j.value("byIdPath", std::string());
+    dev.identity.phys = j.value("phys", std::string());
+}
+
+inline void to_json(json& j, const RealtimeConfig& rt) {
+    j = json{
+        {"policy", rt.policy},
+        {"inputPriority", rt.inputPriority}, {"midiPriority", rt.midiPriority},
+        {"inputCpu", rt.inputCpu}, {"midiCpu", rt.midiCpu},
+        {"lockMemory", rt.lockMemory}
+    };
+}
+
+inline void from_json(const json& j, RealtimeConfig& rt) {
+    rt.policy = j.value("policy", std::string("fifo"));
+    rt.inputPriority = j.value("inputPriority", 0);
+    rt.midiPriority = j.value("midiPriority", 0);
+    rt.inputCpu = j.value("inputCpu", -1);
+    rt.midiCpu = j.value("midiCpu", -1);
+    rt.lockMemory = j.value("lockMemory", false);
+}
+
+inline void to_json(json& j, const MidiMappingConfig& cfg) {
+    j = json{
+        {"devices", cfg.devices},
+        {"midiDeviceName", cfg.midiDeviceName},
+        {"defaultMidiChannel", cfg.defaultMidiChannel},
+        {"midiSendIntervalMs", cfg.midiSendIntervalMs},
+        {"mappings", cfg.mappings}
+    };
+    // Single-device keys kept so older versions can still load the primary device
+    if (!cfg.devices.empty()) {
+        j["hidDevicePath"] = cfg.devices[0].path;
+        j["hidDeviceName"] = cfg.devices[0].name;
+    }
+    if (!cfg.realtime.isDefault()) j["realtime"] = cfg.realtime;
+}
+
+inline void from_json(const json& j, MidiMappingConfig& cfg) {
+    if (j.contains("devices")) {
+        j.at("devices").get_to(cfg.devices);
+    } else {
+        InputDeviceConfig dev;
+        j.at("hidDevicePath").get_to(dev.path);
+        j.at("hidDeviceName").get_to(dev.name);
+        cfg.devices = {dev};
+    }
+    j.at("midiDeviceName").get_to(cfg.midiDeviceName);
+    cfg.defaultMidiChannel = j.value("defaultMidiChannel", 0);
+    cfg.midiSendIntervalMs = j.value("midiSendIntervalMs", 1);
+    j.at("mappings").get_to(cfg.mappings);
+    cfg.realtime = j.contains("realtime") ? j.at("realtime").get<RealtimeConfig>() : RealtimeConfig();
+}
+
+inline int GetEffectiveChannel(const ControlMapping& mapping, int defaultChannel) {
+    return (mapping.midiChannel >= 0) ? mapping.midiChannel : defaultChannel;
+}
@@ -0,0 +1,414 @@
+#pragma once
+// ===================================================================================
+// MappingEngine.h - Input value to MIDI mapping engine
+// ===================================================================================
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "MappingConfig.h"
+#include "EventRing.h"
+#include "LatencyHistogram.h"
+#include "MidiSink.h"
+#include "Logger.h"
+
+inline uint64_t SteadyNowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Per-mapping state tracking
+struct MappingState {
+    std::atomic<LONG> currentValue{0};
+    std::atomic<bool> valueChanged{false};  // Axis update queued (latest-wins) or resync needed
+    std::atomic<bool> snapshotPending{false};  // A snapshot was merged into the queued axis update
+    std::atomic<uint64_t> changedAtNs{0};   // Input timestamp of the oldest undelivered change
+    // Button events that did not fit in the ring: transition count << 2 | pending << 1 | last value
+    std::atomic<uint32_t> missedButton{0};
+    LONG previousValue = -1;
+    int lastSentMidiValue = -1;
+    // Input timestamp -> MIDI send latency; allocated once so recording never allocates
+    std::unique_ptr<LatencyHistogram> latency = std::make_unique<LatencyHistogram>();
+
+    MappingState() = default;
+    MappingState(MappingState&& other) noexcept
+        : currentValue(other.currentValue.load()),
+          valueChanged(other.valueChanged.load()),
+          snapshotPending(other.snapshotPending.load()),
+          changedAtNs(other.changedAtNs.load()),
+          missedButton(other.missedButton.load()),
+          previousValue(other.previousValue),
+          lastSentMidiValue(other.lastSentMidiValue),
+          latency(std::move(other.latency)) {}
+    MappingState& operator=(MappingState&& other) noexcept {
+        currentValue = other.currentValue.load();
+        valueChanged = other.valueChanged.load();
+        snapshotPending = other.snapshotPending.load();
+        changedAtNs = other.changedAtNs.load();
+        missedButton = other.missedButton.load();
+        previousValue = other.previousValue;
+        lastSentMidiValue = other.lastSentMidiValue;
+        latency = std::move(other.latency);
+        return *this;
+    }
+    MappingState(const MappingState&) = delete;
+    MappingState& operator=(const MappingState&) = delete;
+};
+
+// --- Input Event Queue ---
+// Every value change seen by the input thread is handed to the MIDI dispatcher through a
+// bounded SPSC ring. Buttons enqueue every transition so fast presses are never merged;
+// axes keep at most one queued entry and the dispatcher reads the latest value (coalescing).
+// Button transitions that find the ring full are counted per mapping together with the
+// latest value, and replayed as the same on/off sequence once the ring has been drained,
+// so a press+release is not lost to an overflow.
+struct InputEvent {
+    uint64_t timestampNs = 0;  // Input time on the steady_clock timeline (kernel event time on Linux)
+    uint32_t mappingIndex = 0;
+    LONG value = 0;
+    bool snapshot = false;     // Part of an initial state burst: send even if unchanged
+};
+
+struct InputEventStats {
+    std::atomic<uint64_t> buttonEvents{0};
+    std::atomic<uint64_t> axisEvents{0};
+    std::atomic<uint64_t> axisCoalesced{0};
+    std::atomic<uint64_t> ringOverflows{0};
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> synDropped{0};  // Kernel evdev buffer overruns (Linux)
+};
+
+// Calibrated axis value -> MIDI data byte (0-127), or -1 if the axis is not calibrated
+inline int AxisToMidiValue(const ControlMapping& mapping, LONG value) {
+    if (!mapping.calibrationDone) return -1;
+    LONG range = mapping.calibrationMaxHid - mapping.calibrationMinHid;
+    if (range <= 0) return -1;
+
+    LONG clamped = std::max(mapping.calibrationMinHid, std::min(mapping.calibrationMaxHid, value));
+    double norm = (double)(clamped - mapping.calibrationMinHid) / range;
+    if (mapping.reverseAxis) norm = 1.0 - norm;
+    return (int)(norm * 127.0 + 0.5);
+}
+
+// Turns control values into MIDI messages. One input thread publishes values and commits
+// them frame by frame; one dispatcher thread calls dispatch() to send the resulting MIDI
+// to the attached sink. The engine has no platform dependencies, so the same code runs
+// against real devices, recordings and synthetic sources.
+class MappingEngine {
+public:
+    static const size_t EVENT_RING_SIZE = 4096;
+    using WakeFn = void (*)();
+
+    // The mappings are read from config on every call; after editing them, call
+    // resetStates(). wakeDispatcher is invoked by the input thread when a committed frame
+    // carries changes (may be null when the caller drives dispatch() itself).
+    void attach(const MidiMappingConfig* config, MidiSink* sink, WakeFn wakeDispatcher = nullptr) {
+        m_config = config;
+        m_sink = sink;
+        m_wakeDispatcher = wakeDispatcher;
+    }
+    void setSink(MidiSink* sink) { m_sink = sink; }
+
+    // Reallocates the states, which publish() indexes without locking: only call while
+    // no input thread is running
+    void resetStates() {
+        m_states.clear();
+        m_states.resize(m_config ? m_config->mappings.size() : 0);
+    }
+
+    std::vector<MappingState>& states() { return m_states; }
+    const std::vector<MappingState>& states() const { return m_states; }
+    InputEventStats& stats() { return m_stats; }
+    const ControlMapping& mappingAt(size_t i) const { return m_config->mappings[i]; }
+
+    // Events are only queued while active (monitoring); otherwise only the live values
+    // used by calibration and the display are updated
+    void setActive(bool active) { m_active.store(active, std::memory_order_release); }
+    bool active() const { return m_active.load(std::memory_order_acquire); }
+
+    // Called by the input thread for every value read from the device. Updates the live
+    // value and, while active, stages the change for the dispatcher; staged events become
+    // visible at commitFrame(). Snapshot values are queued even if unchanged. timestampNs
+    // is when the input happened (0 = now). Returns true if anything was published.
+    bool publish(size_t mappingIndex, LONG value, bool snapshot = false, uint64_t timestampNs = 0) {
+        auto& state = m_states[mappingIndex];
+        // Buttons are on/off: an evdev autorepeat (value 2) is no transition
+        const bool isButton = m_config->mappings[mappingIndex].control.isButton;
+        if (isButton) value = value != 0 ? 1 : 0;
+        if (!snapshot && state.currentValue.load(std::memory_order_relaxed) == value) return false;
+        state.currentValue.store(value);
+
+        if (!active()) return true;
+
+        InputEvent event;
+        event.timestampNs = timestampNs ? timestampNs : SteadyNowNs();
+        event.mappingIndex = static_cast<uint32_t>(mappingIndex);
+        event.value = value;
+        event.snapshot = snapshot;
+
+        if (isButton) {
+            // Buttons: every transition is queued. Once one has missed the ring, later ones
+            // are counted as well until the dispatcher has replayed them, which keeps the order.
+            if (state.missedButton.load(std::memory_order_acquire) == 0 && m_ring.stage(event)) {
+                m_stats.buttonEvents.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            // Ring full: count the transition and remember the value in one atomic word, so
+            // the dispatcher always takes a count and the value it ends on together. A
+            // snapshot entry is no transition; it only asks for the final state.
+            uint32_t missed = state.missedButton.load(std::memory_order_relaxed);
+            if (missed == 0) state.changedAtNs.store(event.timestampNs);
+            uint32_t next;
+            do {
+                next = ((missed & ~MISSED_VALUE) + (snapshot ? 0 : MISSED_ONE)) | MISSED_PENDING |
+                       (value != 0 ? MISSED_VALUE : 0);
+            } while (!state.missedButton.compare_exchange_weak(missed, next, std::memory_order_acq_rel));
+            m_stats.buttonEvents.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            // Axes: latest-wins, at most one queued entry per mapping. Latency is measured
+            // from the oldest change that has not been sent yet. A snapshot merged into an
+            // update that is already queued (or that misses the ring) is carried by
+            // snapshotPending, so the dispatcher still forces the send.
+            if (snapshot) state.snapshotPending.store(true);
+            if (state.valueChanged.exchange(true)) {
+                m_stats.axisCoalesced.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            state.changedAtNs.store(event.timestampNs);
+            if (m_ring.stage(event)) {
+                m_stats.axisEvents.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        m_stats.ringOverflows.fetch_add(1, std::memory_order_relaxed);
+        m_overflowInFrame = true;
+        return true;
+    }
+
+    // Makes every event staged since the last commit visible to the dispatcher at once and
+    // wakes it, so all changes from one input report are sent together.
+    // An overflow is announced only after the frame's ring entries are visible, so the
+    // dispatcher drains those before it delivers what missed the ring.
+    void commitFrame(bool anyChanged) {
+        m_ring.publish();
+        if (m_overflowInFrame) {
+            m_overflowInFrame = false;
+            m_ringOverflowed.store(true, std::memory_order_release);
+        }
+        m_stats.frames.fetch_add(1, std::memory_order_relaxed);
+        if (anyChanged && m_wakeDispatcher) m_wakeDispatcher();
+    }
+
+    // Drains the input event ring and sends the resulting MIDI messages.
+    // Returns true if any mapping changed (so the monitoring display needs a refresh).
+    bool dispatch() {
+        bool anyChanged = false;
+        const auto& mappings = m_config->mappings;
+        const size_t mappingCount = std::min(mappings.size(), m_states.size());
+        // Taken before draining: everything queued ahead of the missed events is sent first
+        const bool overflowed = m_ringOverflowed.exchange(false, std::memory_order_acquire);
+
+        InputEvent event;
+        while (m_ring.pop(event)) {
+            if (event.mappingIndex >= mappingCount) continue;
+            const auto& mapping = mappings[event.mappingIndex];
+            auto& state = m_states[event.mappingIndex];
+            anyChanged = true;
+
+            // Snapshot entries forget the last sent state so the current one is always emitted
+            if (event.snapshot) {
+                state.previousValue = -1;
+                state.lastSentMidiValue = -1;
+            }
+            uint64_t inputTimestampNs = event.snapshot ? 0 : event.timestampNs;
+            if (mapping.control.isButton) {
+                if (event.snapshot && event.value == 0) state.previousValue = 1;  // Force the "off" message
+                if (sendButton(mapping, state, event.value)) recordLatency(state, inputTimestampNs);
+            } else if (state.valueChanged.exchange(false)) {
+                if (takeAxisSnapshot(state)) inputTimestampNs = 0;
+                if (sendAxis(mapping, state, state.currentValue.load())) recordLatency(state, inputTimestampNs);
+            }
+        }
+
+        // After an overflow, deliver what missed the ring: every counted button transition
+        // and the latest value of every axis
+        if (overflowed) {
+            LOG_WARN_S("Input event ring overflowed (" << m_stats.ringOverflows.load() << " total)");
+            for (size_t i = 0; i < mappingCount; ++i) {
+                auto& state = m_states[i];
+                const auto& mapping = mappings[i];
+                bool sent = false;
+                if (mapping.control.isButton) {
+                    const uint32_t missed = state.missedButton.exchange(0, std::memory_order_acq_rel);
+                    if (missed == 0) continue;
+                    sent = replayButton(mapping, state, missed);
+                } else {
+                    if (!state.valueChanged.exchange(false)) continue;
+                    const bool snapshot = takeAxisSnapshot(state);
+                    sent = sendAxis(mapping, state, state.currentValue.load());
+                    if (snapshot) sent = false;  // Not triggered by an input: no latency sample
+                }
+                if (sent) recordLatency(state, state.changedAtNs.load());
+                anyChanged = true;
+            }
+        }
+        // One delivery for everything produced by the frames drained above
+        if (anyChanged) m_sink->flush();
+        return anyChanged;
+    }
+
+    // Bank switching shifts the MIDI channel of every mapping by bank (mod 16). Held notes
+    // are released on their old channel and the current state of every control is sent on
+    // the new one. Dispatcher thread only, like dispatch().
+    void setBank(int bank) {
+        bank = ((bank % 16) + 16) % 16;
+        if (bank == m_bank.load(std::memory_order_relaxed)) return;
+        releaseHeldNotes();
+        m_bank.store(bank, std::memory_order_relaxed);
+        const size_t mappingCount = std::min(m_config->mappings.size(), m_states.size());
+        for (size_t i = 0; i < mappingCount; ++i) {
+            const auto& mapping = m_config->mappings[i];
+            auto& state = m_states[i];
+            const LONG value = state.currentValue.load();
+            if (mapping.control.isButton) {
+                state.previousValue = value == 0 ? 1 : -1;  // Forces the message for either state
+                sendButton(mapping, state, value);
+            } else {
+                state.lastSentMidiValue = -1;
+                sendAxis(mapping, state, value);
+            }
+        }
+        m_sink->flush();
+        LOG_INFO_S("Bank " << bank << " selected");
+    }
+    int bank() const { return m_bank.load(std::memory_order_relaxed); }
+
+    // All notes off: releases every held note, then sends All Sound Off (CC 120) and All
+    // Notes Off (CC 123) on all 16 channels. A control held through the panic sends its
+    // next message when it is released and pressed again. Dispatcher thread only.
+    void panic() {
+        releaseHeldNotes();
+        for (int channel = 0; channel < 16; ++channel) {
+            m_sink->send(MidiMessage::controlChange(channel, 120, 0));
+            m_sink->send(MidiMessage::controlChange(channel, 123, 0));
+        }
+        m_sink->flush();
+        LOG_INFO("Panic: all notes off");
+    }
+
+private:
+    // MIDI channel of a mapping in the current bank
+    int channelOf(const ControlMapping& mapping) const {
+        return (GetEffectiveChannel(mapping, m_config->defaultMidiChannel) + m_bank.load(std::memory_order_relaxed)) & 0x0F;
+    }
+
+    // Sends Note Off for every note mapping whose button is down and marks it released
+    void releaseHeldNotes() {
+        const size_t mappingCount = std::min(m_config->mappings.size(), m_states.size());
+        for (size_t i = 0; i < mappingCount; ++i) {
+            const auto& mapping = m_config->mappings[i];
+            auto& state = m_states[i];
+            if (!mapping.control.isButton || mapping.midiMessageType != MidiMessageType::NOTE_ON_OFF) continue;
+            if (state.previousValue <= 0) continue;
+            m_sink->send(MidiMessage::noteOff(channelOf(mapping), mapping.midiNoteOrCCNumber));
+            state.previousValue = 0;
+        }
+    }
+
+    // send* return true if a message was sent. The message stays on the stack and the
+    // sinks send it without copying into a heap buffer, so no allocation per message.
+    bool sendButton(const ControlMapping& mapping, MappingState& state, LONG value) {
+        bool pressed = value != 0;
+        bool wasPressed = state.previousValue > 0;  // previousValue < 0 means "unknown"
+        state.previousValue = value;
+        if (pressed == wasPressed) return false;
+
+        int channel = channelOf(mapping);
+        MidiMessage message;
+        if (mapping.midiMessageType == MidiMessageType::NOTE_ON_OFF) {
+            message = pressed ? MidiMessage::noteOn(channel, mapping.midiNoteOrCCNumber, mapping.midiValueNoteOnVelocity)
+                              : MidiMessage::noteOff(channel, mapping.midiNoteOrCCNumber);
+            LOG_DEBUG_S(mapping.control.name << ": Note " << (pressed ? "On" : "Off")
+                       << " Ch" << (channel+1) << " Note" << mapping.midiNoteOrCCNumber
+                       << " Vel" << (pressed ? mapping.midiValueNoteOnVelocity : 0));
+        } else {
+            message = MidiMessage::controlChange(channel, mapping.midiNoteOrCCNumber,
+                                                 pressed ? mapping.midiValueCCOn : mapping.midiValueCCOff);
+            LOG_DEBUG_S(mapping.control.name << ": CC Ch" << (channel+1)
+                       << " CC" << mapping.midiNoteOrCCNumber
+                       << " Val" << (pressed ? mapping.midiValueCCOn : mapping.midiValueCCOff));
+        }
+        m_sink->send(message);
+        return true;
+    }
+
+    // Replays the button transitions counted in missedButton. Each transition flips the
+    // value, so the sequence is rebuilt backwards from the last value: n transitions ending
+    // in v are !v, v, !v, ..., v. sendButton() skips any step that is no change for the
+    // receiver, exactly as it would have for the queued events.
+    bool replayButton(const ControlMapping& mapping, MappingState& state, uint32_t missed) {
+        const LONG last = (missed & MISSED_VALUE) ? 1 : 0;
+        const uint32_t transitions = missed / MISSED_ONE;
+        bool sent = false;
+        if (transitions == 0) {
+            // Snapshot only: forced like a queued snapshot entry
+            state.previousValue = last ? -1 : 1;
+            return sendButton(mapping, state, last);
+        }
+        for (uint32_t k = transitions; k > 0; --k) {
+            const LONG value = ((k - 1) % 2 == 0) ? last : 1 - last;
+            if (sendButton(mapping, state, value)) sent = true;
+        }
+        return sent;
+    }
+
+    // Consumes a snapshot merged into an axis update; the next sendAxis() then emits the
+    // value even if it equals the last one sent. Call after clearing valueChanged.
+    bool takeAxisSnapshot(MappingState& state) {
+        if (!state.snapshotPending.exchange(false)) return false;
+        state.previousValue = -1;
+        state.lastSentMidiValue = -1;
+        return true;
+    }
+
+    bool sendAxis(const ControlMapping& mapping, MappingState& state, LONG value) {
+        state.previousValue = value;
+        int midiVal = AxisToMidiValue(mapping, value);
+        if (midiVal < 0 || midiVal == state.lastSentMidiValue) return false;
+
+        int channel = channelOf(mapping);
+        m_sink->send(MidiMessage::controlChange(channel, mapping.midiNoteOrCCNumber, midiVal));
+        LOG_DEBUG_S(mapping.control.name << ": CC Ch" << (channel+1)
+                   << " CC" << mapping.midiNoteOrCCNumber << " Val" << midiVal);
+        state.lastSentMidiValue = midiVal;
+        return true;
+    }
+
+    // Records the input-to-send latency of a delivered change. Snapshot sends are not
+    // triggered by an input and are excluded.
+    void recordLatency(MappingState& state, uint64_t inputTimestampNs) {
+        if (inputTimestampNs == 0) return;
+        uint64_t now = SteadyNowNs();
+        state.latency->record(now > inputTimestampNs ? now - inputTimestampNs : 0);
+    }
+
+    // MappingState::missedButton fields
+    static const uint32_t MISSED_VALUE = 1u << 0;    // Latest value (pressed)
+    static const uint32_t MISSED_PENDING = 1u << 1;  // Something to deliver
+    static const uint32_t MISSED_ONE = 1u << 2;      // One counted transition
+
+    const MidiMappingConfig* m_config = nullptr;
+    MidiSink* m_sink = nullptr;
+    WakeFn m_wakeDispatcher = nullptr;
+    std::vector<MappingState> m_states;
+    SpscRing<InputEvent, EVENT_RING_SIZE> m_ring;
+    InputEventStats m_stats;
+    std::atomic<bool> m_ringOverflowed{false};
+    bool m_overflowInFrame = false;  // Input thread only
+    std::atomic<bool> m_active{false};
+    std::atomic<int> m_bank{0};  // Written by the dispatcher, read by the display and stats
+};
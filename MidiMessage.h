@@ -0,0 +1,38 @@
+#pragma once
+// ===================================================================================
+// MidiMessage.h - Fixed-size MIDI channel message
+// ===================================================================================
+
+#include <cstddef>
+#include <cstdint>
+
+// A channel voice message held inline (no heap storage), so building and sending one
+// on the dispatch path never allocates. Pass data()/size() to RtMidi's
+// sendMessage(const unsigned char*, size_t) overload.
+struct MidiMessage {
+    unsigned char bytes[3] = {0, 0, 0};
+    uint8_t length = 0;
+
+    static MidiMessage noteOn(int channel, int note, int velocity) {
+        return make(0x90, channel, note, velocity);
+    }
+    static MidiMessage noteOff(int channel, int note) {
+        return make(0x80, channel, note, 0);
+    }
+    static MidiMessage controlChange(int channel, int controller, int value) {
+        return make(0xB0, channel, controller, value);
+    }
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    static MidiMessage make(int status, int channel, int data1, int data2) {
+        MidiMessage message;
+        message.bytes[0] = (unsigned char)(status | (channel & 0x0F));
+        message.bytes[1] = (unsigned char)(data1 & 0x7F);
+        message.bytes[2] = (unsigned char)(data2 & 0x7F);
+        message.length = 3;
+        return message;
+    }
+};
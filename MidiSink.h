@@ -0,0 +1,235 @@
+#pragma once
+// ===================================================================================
+// MidiSink.h - MIDI output backends (RtMidi, native ALSA sequencer, in-memory)
+// ===================================================================================
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rtmidi/RtMidi.h"
+#include "MidiMessage.h"
+
+#ifdef JOYSTICKMIDI_ALSA_SEQ
+#include <alsa/asoundlib.h>
+#include <cerrno>
+#endif
+
+// Output port abstraction used by the dispatcher. send() may buffer; flush() delivers
+// everything buffered since the previous flush and is called once per dispatch pass,
+// so all messages produced by one input frame leave together.
+//
+// Port names use RtMidi's format on every backend, so a saved midiDeviceName resolves
+// to the same port whichever backend is selected.
+class MidiSink {
+public:
+    virtual ~MidiSink() = default;
+
+    virtual const char* backendName() const = 0;
+    virtual unsigned int getPortCount() = 0;
+    virtual std::string getPortName(unsigned int port) = 0;
+    virtual bool openPort(unsigned int port) = 0;
+    virtual bool isPortOpen() const = 0;
+    virtual void closePort() = 0;
+
+    virtual void send(const MidiMessage& message) = 0;
+    virtual void flush() {}
+};
+
+// --- RtMidi backend (default, all platforms) ---
+// Every send() goes straight to the port; flush() is a no-op.
+class RtMidiSink : public MidiSink {
+public:
+    const char* backendName() const override { return "rtmidi"; }
+    unsigned int getPortCount() override { return m_out.getPortCount(); }
+    std::string getPortName(unsigned int port) override { return m_out.getPortName(port); }
+    bool openPort(unsigned int port) override {
+        m_out.openPort(port);
+        return m_out.isPortOpen();
+    }
+    bool isPortOpen() const override { return m_out.isPortOpen(); }
+    void closePort() override { m_out.closePort(); }
+
+    void send(const MidiMessage& message) override {
+        m_out.sendMessage(message.data(), message.size());
+    }
+
+private:
+    RtMidiOut m_out;
+};
+
+#ifdef JOYSTICKMIDI_ALSA_SEQ
+// --- Native ALSA sequencer backend (Linux) ---
+// Builds snd_seq_event_t directly from the message, writes it into the client's output
+// buffer and drains the buffer once per flush(). Events use direct (unqueued) delivery
+// to the subscribed destination, so no sequencer queue or timestamping is involved.
+class AlsaSeqSink : public MidiSink {
+public:
+    AlsaSeqSink() {
+        if (snd_seq_open(&m_seq, "default", SND_SEQ_OPEN_OUTPUT, 0) < 0) {
+            m_seq = nullptr;
+            return;
+        }
+        snd_seq_set_client_name(m_seq, "JoystickMIDI");
+        m_port = snd_seq_create_simple_port(m_seq, "JoystickMIDI Output",
+                                            SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ,
+                                            SND_SEQ_PORT_TYPE_MIDI_GENERIC | SND_SEQ_PORT_TYPE_APPLICATION);
+    }
+    ~AlsaSeqSink() override {
+        if (!m_seq) return;
+        closePort();
+        snd_seq_close(m_seq);
+    }
+    AlsaSeqSink(const AlsaSeqSink&) = delete;
+    AlsaSeqSink& operator=(const AlsaSeqSink&) = delete;
+
+    bool valid() const { return m_seq && m_port >= 0; }
+
+    const char* backendName() const override { return "alsa"; }
+
+    unsigned int getPortCount() override {
+        refreshPorts();
+        return (unsigned int)m_ports.size();
+    }
+    std::string getPortName(unsigned int port) override {
+        if (port >= m_ports.size()) refreshPorts();
+        return port < m_ports.size() ? m_ports[port].name : std::string();
+    }
+
+    bool openPort(unsigned int port) override {
+        if (!valid()) return false;
+        if (port >= m_ports.size()) refreshPorts();
+        if (port >= m_ports.size()) return false;
+        closePort();
+        if (snd_seq_connect_to(m_seq, m_port, m_ports[port].client, m_ports[port].port) < 0) return false;
+        m_dest = m_ports[port];
+        m_open = true;
+        return true;
+    }
+    bool isPortOpen() const override { return m_open; }
+    void closePort() override {
+        if (!m_open) return;
+        snd_seq_drain_output(m_seq);
+        snd_seq_disconnect_to(m_seq, m_port, m_dest.client, m_dest.port);
+        m_open = false;
+    }
+
+    void send(const MidiMessage& message) override {
+        if (!m_open || message.size() < 3) return;
+        const int channel = message.bytes[0] & 0x0F;
+        snd_seq_event_t ev;
+        snd_seq_ev_clear(&ev);
+        snd_seq_ev_set_source(&ev, m_port);
+        snd_seq_ev_set_subs(&ev);
+        snd_seq_ev_set_direct(&ev);
+        switch (message.bytes[0] & 0xF0) {
+            case 0x90: snd_seq_ev_set_noteon(&ev, channel, message.bytes[1], message.bytes[2]); break;
+            case 0x80: snd_seq_ev_set_noteoff(&ev, channel, message.bytes[1], message.bytes[2]); break;
+            case 0xB0: snd_seq_ev_set_controller(&ev, channel, message.bytes[1], message.bytes[2]); break;
+            default: return;
+        }
+        // A full output buffer is drained early rather than dropping the event
+        if (snd_seq_event_output_buffer(m_seq, &ev) == -EAGAIN) {
+            snd_seq_drain_output(m_seq);
+            snd_seq_event_output_buffer(m_seq, &ev);
+        }
+        m_pending = true;
+    }
+
+    void flush() override {
+        if (!m_pending) return;
+        snd_seq_drain_output(m_seq);
+        m_pending = false;
+    }
+
+private:
+    struct PortAddress {
+        int client = -1;
+        int port = -1;
+        std::string name;
+    };
+
+    // Same selection and "client:port c:p" naming as RtMidi's ALSA output port list
+    void refreshPorts() {
+        m_ports.clear();
+        if (!m_seq) return;
+        snd_seq_client_info_t* cinfo;
+        snd_seq_port_info_t* pinfo;
+        snd_seq_client_info_alloca(&cinfo);
+        snd_seq_port_info_alloca(&pinfo);
+        const unsigned int wanted = SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE;
+        snd_seq_client_info_set_client(cinfo, -1);
+        while (snd_seq_query_next_client(m_seq, cinfo) >= 0) {
+            int client = snd_seq_client_info_get_client(cinfo);
+            if (client == 0 || client == snd_seq_client_id(m_seq)) continue;
+            snd_seq_port_info_set_client(pinfo, client);
+            snd_seq_port_info_set_port(pinfo, -1);
+            while (snd_seq_query_next_port(m_seq, pinfo) >= 0) {
+                unsigned int type = snd_seq_port_info_get_type(pinfo);
+                if (!(type & (SND_SEQ_PORT_TYPE_MIDI_GENERIC | SND_SEQ_PORT_TYPE_SYNTH | SND_SEQ_PORT_TYPE_APPLICATION))) continue;
+                if ((snd_seq_port_info_get_capability(pinfo) & wanted) != wanted) continue;
+                PortAddress address;
+                address.client = client;
+                address.port = snd_seq_port_info_get_port(pinfo);
+                address.name = std::string(snd_seq_client_info_get_name(cinfo)) + ":" +
+                               snd_seq_port_info_get_name(pinfo) + " " +
+                               std::to_string(address.client) + ":" + std::to_string(address.port);
+                m_ports.push_back(std::move(address));
+            }
+        }
+    }
+
+    snd_seq_t* m_seq = nullptr;
+    int m_port = -1;
+    std::vector<PortAddress> m_ports;
+    PortAddress m_dest;
+    bool m_open = false;
+    bool m_pending = false;
+};
+#endif
+
+// --- In-memory sink (benchmarks and tests) ---
+// Keeps the most recent messages in a fixed-capacity buffer allocated up front and counts
+// everything sent, so it adds no allocation or I/O to the path being measured.
+class MemoryMidiSink : public MidiSink {
+public:
+    explicit MemoryMidiSink(size_t capacity = 4096) : m_messages(capacity) {}
+
+    const char* backendName() const override { return "memory"; }
+    unsigned int getPortCount() override { return 1; }
+    std::string getPortName(unsigned int) override { return "Memory"; }
+    bool openPort(unsigned int) override { m_open = true; return true; }
+    bool isPortOpen() const override { return m_open; }
+    void closePort() override { m_open = false; }
+
+    void send(const MidiMessage& message) override {
+        if (!m_messages.empty()) m_messages[m_sent % m_messages.size()] = message;
+        m_sent++;
+    }
+    void flush() override { m_flushes++; }
+
+    uint64_t sent() const { return m_sent; }
+    uint64_t flushes() const { return m_flushes; }
+    // i-th most recent message (0 = last); only valid for i < min(sent(), capacity)
+    const MidiMessage& recent(size_t i) const { return m_messages[(m_sent - 1 - i) % m_messages.size()]; }
+    void clear() { m_sent = 0; m_flushes = 0; }
+
+private:
+    std::vector<MidiMessage> m_messages;
+    uint64_t m_sent = 0;
+    uint64_t m_flushes = 0;
+    bool m_open = false;
+};
+
+// Returns nullptr for an unknown or unavailable backend
+inline std::unique_ptr<MidiSink> CreateMidiSink(const std::string& backend) {
+    if (backend.empty() || backend == "rtmidi") return std::make_unique<RtMidiSink>();
+#ifdef JOYSTICKMIDI_ALSA_SEQ
+    if (backend == "alsa") {
+        auto sink = std::make_unique<AlsaSeqSink>();
+        if (sink->valid()) return sink;
+    }
+#endif
+    return nullptr;
+}
@@ -0,0 +1,153 @@
+#pragma once
+// ===================================================================================
+// MonitorView.h - Text rendering of the live monitoring display
+// ===================================================================================
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "MappingConfig.h"
+#include "MappingEngine.h"
+
+// One monitor row for a mapping: "[name        ] ON " for buttons, a 20-column bar and
+// percentage of the calibrated range for axes, plus the p99 input-to-MIDI latency once
+// anything was sent. Writes at most size - 1 characters plus a terminator into out and
+// returns the row length; never allocates.
+inline size_t FormatMonitoringRow(const ControlMapping& mapping, LONG value, const LatencyHistogram* latency,
+                                  char* out, size_t size) {
+    const int BAR_WIDTH = 20;
+    int n = std::snprintf(out, size, "[%-12.12s] ", mapping.control.name.c_str());
+
+    auto remaining = [&]() { return n < static_cast<int>(size) ? size - static_cast<size_t>(n) : 0; };
+    if (mapping.control.isButton) {
+        n += std::snprintf(out + n, remaining(), "%s", value ? "ON " : "OFF");
+    } else {
+        double percentage = 0.0;
+        LONG displayRangeMin = mapping.control.logicalMin;
+        LONG displayRangeMax = mapping.control.logicalMax;
+
+        if (mapping.calibrationDone) {
+            displayRangeMin = mapping.calibrationMinHid;
+            displayRangeMax = mapping.calibrationMaxHid;
+        }
+
+        LONG displayRange = displayRangeMax - displayRangeMin;
+        if (displayRange > 0) {
+            LONG clampedValue = std::max(displayRangeMin, std::min(displayRangeMax, value));
+            percentage = static_cast<double>(clampedValue - displayRangeMin) * 100.0 / static_cast<double>(displayRange);
+        } else if (value >= displayRangeMax) {
+            percentage = 100.0;
+        }
+
+        int barLength = static_cast<int>((percentage / 100.0) * BAR_WIDTH + 0.5);
+        barLength = std::max(0, std::min(BAR_WIDTH, barLength));
+
+        static const char BAR[] = "####################--------------------";
+        n += std::snprintf(out + n, remaining(), "|%.*s%.*s| %3.0f%%", barLength, BAR, BAR_WIDTH - barLength,
+                           BAR + BAR_WIDTH, percentage);
+    }
+    if (latency && latency->count() > 0) {
+        n += std::snprintf(out + n, remaining(), "  p99 %.2f ms", latency->percentile(0.99) / 1e6);
+    }
+    return std::min(static_cast<size_t>(std::max(n, 0)), size - 1);
+}
+
+// Keeps the last drawn text of every row and turns a refresh into a single buffer holding
+// only the rows whose text changed, so the cost of a frame follows input activity rather
+// than the number of mappings. Rows are skipped without formatting when neither the value
+// nor the latency histogram moved since they were drawn.
+//
+// The region is drawn once in full below the cursor; afterwards the cursor is kept on the
+// line just below the last row and changed rows are reached with relative ANSI cursor
+// movement. Without ANSI support (legacy Windows console) every changed frame rewrites all
+// rows and the caller positions the cursor at the top of the region first.
+class MonitorRenderer {
+public:
+    static const size_t ROW_WIDTH = 72;
+
+    // Preallocates for rowCount rows; the next render() draws the whole region
+    void reset(size_t rowCount, bool ansi = true) {
+        m_rowCount = rowCount;
+        m_ansi = ansi;
+        m_text.assign(rowCount * ROW_WIDTH, '\0');
+        m_length.assign(rowCount, 0);
+        m_seenValue.assign(rowCount, 0);
+        m_seenLatencyCount.assign(rowCount, 0);
+        m_frame.clear();
+        m_frame.reserve(rowCount * (ROW_WIDTH + 16) + 16);
+        m_drawn = false;
+    }
+
+    bool ansi() const { return m_ansi; }
+
+    // Builds frame() from the current state; returns the number of rows rewritten
+    // (0 = nothing to write)
+    size_t render(const MidiMappingConfig& config, const std::vector<MappingState>& states) {
+        m_frame.clear();
+        const size_t rows = std::min({m_rowCount, config.mappings.size(), states.size()});
+        char row[ROW_WIDTH];
+        size_t changed = 0;
+        size_t cursor = m_rowCount;  // Line below the last row
+        for (size_t i = 0; i < rows; ++i) {
+            const MappingState& state = states[i];
+            const LONG value = state.currentValue.load(std::memory_order_relaxed);
+            const uint64_t latencyCount = state.latency ? state.latency->count() : 0;
+            if (m_drawn && value == m_seenValue[i] && latencyCount == m_seenLatencyCount[i]) continue;
+            m_seenValue[i] = value;
+            m_seenLatencyCount[i] = latencyCount;
+
+            const size_t length = FormatMonitoringRow(config.mappings[i], value, state.latency.get(), row, sizeof(row));
+            char* drawn = &m_text[i * ROW_WIDTH];
+            if (m_drawn && length == m_length[i] && memcmp(drawn, row, length) == 0) continue;
+            memcpy(drawn, row, length);
+            m_length[i] = length;
+            changed++;
+
+            if (m_drawn && m_ansi) {
+                moveCursor(cursor, i);
+                m_frame.append(drawn, length);
+                m_frame += "\033[K";
+                cursor = i;
+            }
+        }
+        if (!m_drawn || (!m_ansi && changed > 0)) {
+            // Full region: every row on its own line, padded over any previous text
+            m_frame.clear();
+            for (size_t i = 0; i < m_rowCount; ++i) {
+                m_frame.append(&m_text[i * ROW_WIDTH], m_length[i]);
+                if (m_ansi) m_frame += "\033[K";
+                else m_frame.append(ROW_WIDTH - m_length[i], ' ');
+                m_frame += '\n';
+            }
+            m_drawn = true;
+            return m_rowCount;
+        }
+        if (changed > 0) moveCursor(cursor, m_rowCount);
+        return changed;
+    }
+
+    const std::string& frame() const { return m_frame; }
+
+private:
+    // Appends the escape sequence moving the cursor from the start of line 'from' to the
+    // start of line 'to' (CPL / CNL)
+    void moveCursor(size_t from, size_t to) {
+        char seq[16];
+        if (from > to) m_frame.append(seq, static_cast<size_t>(std::snprintf(seq, sizeof(seq), "\033[%zuF", from - to)));
+        else if (to > from) m_frame.append(seq, static_cast<size_t>(std::snprintf(seq, sizeof(seq), "\033[%zuE", to - from)));
+        else m_frame += '\r';
+    }
+
+    size_t m_rowCount = 0;
+    bool m_ansi = true;
+    bool m_drawn = false;
+    std::vector<char> m_text;              // ROW_WIDTH characters per row, as last drawn
+    std::vector<size_t> m_length;
+    std::vector<LONG> m_seenValue;
+    std::vector<uint64_t> m_seenLatencyCount;
+    std::string m_frame;
+};
@@ -0,0 +1,338 @@
+// ===================================================================================
+// bench.cpp - Micro-benchmarks for the JoystickMIDI hot paths (JoystickMIDI_bench)
+// ===================================================================================
+//
+// Prints one JSON object per line so results can be stored and diffed between releases:
+//
+//   {"bench":"dispatch","params":{"mappings":64,"events_per_frame":1},"iterations":...,
+//    "ns_per_op":...,"ns_per_op_median":...,"ops_per_sec":...,"allocs_per_op":...}
+//
+// Each case runs --repeat times; ns_per_op is the fastest run, ns_per_op_median the median.
+// allocs_per_op counts global operator new calls during the timed runs. No device or MIDI
+// port is needed: input comes from SyntheticInputSource and output goes to MemoryMidiSink.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Logger.h"
+#include "MappingConfig.h"
+#include "MappingEngine.h"
+#include "InputSource.h"
+#include "MidiSink.h"
+#include "MidiMessage.h"
+#include "MonitorView.h"
+#include "tests/AllocationCounter.h"
+
+namespace fs = std::filesystem;
+using ordered_json = nlohmann::ordered_json;  // Keeps output keys in a stable, readable order
+
+// --- Options ---
+struct BenchOptions {
+    std::string filter;   // Only run cases whose name contains this
+    int repeat = 3;
+    double scale = 1.0;   // Multiplier for iteration counts (e.g. 0.1 for a quick run)
+};
+static BenchOptions g_options;
+
+// Keeps results observable so the measured work is not optimized away
+static volatile uint64_t g_sink = 0;
+
+static uint64_t Scaled(uint64_t iterations) {
+    return std::max<uint64_t>(1, static_cast<uint64_t>(static_cast<double>(iterations) * g_options.scale));
+}
+
+static bool Selected(const std::string& name) {
+    return g_options.filter.empty() || name.find(g_options.filter) != std::string::npos;
+}
+
+// Runs body(iterations) --repeat times; body returns the number of operations it performed
+static void RunCase(const std::string& name, const ordered_json& params, uint64_t iterations,
+                    const std::function<uint64_t(uint64_t)>& body, int repeat = -1) {
+    if (!Selected(name)) return;
+    if (repeat < 0) repeat = g_options.repeat;
+
+    std::vector<double> nsPerOp;
+    uint64_t ops = 0;
+    uint64_t allocations = 0;
+    for (int r = 0; r < repeat; ++r) {
+        const uint64_t allocsBefore = AllocationCount();
+        const uint64_t start = SteadyNowNs();
+        ops = body(iterations);
+        const uint64_t elapsed = SteadyNowNs() - start;
+        allocations += AllocationCount() - allocsBefore;
+        nsPerOp.push_back(ops ? static_cast<double>(elapsed) / static_cast<double>(ops) : 0.0);
+    }
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+
+    ordered_json result;
+    result["bench"] = name;
+    result["params"] = params;
+    result["iterations"] = ops;
+    result["repeat"] = repeat;
+    result["ns_per_op"] = nsPerOp.front();
+    result["ns_per_op_median"] = nsPerOp[nsPerOp.size() / 2];
+    result["ops_per_sec"] = nsPerOp.front() > 0 ? 1e9 / nsPerOp.front() : 0.0;
+    result["allocs_per_op"] = ops ? static_cast<double>(allocations) / static_cast<double>(ops * repeat) : 0.0;
+    std::cout << result.dump() << std::endl;
+}
+
+// --- Fixtures ---
+
+// Alternating calibrated CC axes (0-1023) and note buttons, spread over 16 channels
+static MidiMappingConfig MakeConfig(size_t mappingCount) {
+    MidiMappingConfig config;
+    config.midiDeviceName = "Memory";
+    config.devices.push_back(InputDeviceConfig{"/dev/input/event0", "Bench Device", DeviceIdentity{}});
+    for (size_t i = 0; i < mappingCount; ++i) {
+        ControlMapping mapping;
+        mapping.control.isButton = (i % 2) == 1;
+        mapping.control.name = (mapping.control.isButton ? "Button " : "Axis ") + std::to_string(i);
+#ifndef _WIN32
+        mapping.control.eventType = mapping.control.isButton ? 0x01 : 0x03;
+        mapping.control.eventCode = static_cast<uint16_t>(i);
+#endif
+        mapping.midiChannel = static_cast<int>(i % 16);
+        mapping.midiNoteOrCCNumber = static_cast<int>(i % 128);
+        if (mapping.control.isButton) {
+            mapping.control.logicalMax = 1;
+            mapping.midiMessageType = MidiMessageType::NOTE_ON_OFF;
+        } else {
+            mapping.control.logicalMax = 1023;
+            mapping.midiMessageType = MidiMessageType::CC;
+            mapping.calibrationMinHid = 0;
+            mapping.calibrationMaxHid = 1023;
+            mapping.calibrationDone = true;
+        }
+        config.mappings.push_back(mapping);
+    }
+    return config;
+}
+
+// Engine wired to a memory sink; the ring is drained inline, so no dispatcher thread
+struct EngineFixture {
+    MidiMappingConfig config;
+    MemoryMidiSink sink;
+    std::unique_ptr<MappingEngine> engine = std::make_unique<MappingEngine>();
+
+    explicit EngineFixture(size_t mappingCount) : config(MakeConfig(mappingCount)) {
+        sink.openPort(0);
+        engine->attach(&config, &sink);
+        engine->resetStates();
+        engine->setActive(true);
+    }
+};
+
+// --- Cases ---
+
+// Full publish -> commit -> dispatch -> send path per input event
+static void BenchDispatch() {
+    for (size_t mappings : {1, 8, 64, 512}) {
+        std::vector<size_t> eventsPerFrameCases = {1};
+        if (mappings > 1) eventsPerFrameCases.push_back(mappings);  // Every mapping changes each frame
+        for (size_t eventsPerFrame : eventsPerFrameCases) {
+            EngineFixture fixture(mappings);
+            const uint64_t frames = Scaled(2000000 / eventsPerFrame);
+            RunCase("dispatch", {{"mappings", mappings}, {"events_per_frame", eventsPerFrame}}, frames,
+                    [&](uint64_t n) {
+                        std::atomic<bool> quit{false};
+                        SyntheticInputSource source(n, eventsPerFrame, std::chrono::nanoseconds(0), true);
+                        source.run(*fixture.engine, quit);
+                        return n * eventsPerFrame;
+                    });
+            g_sink = g_sink + fixture.sink.sent();
+        }
+    }
+}
+
+// A single axis paced like a 1 kHz controller; verifies the send path stays allocation-free
+static void BenchAxisSweep() {
+    EngineFixture fixture(1);
+    RunCase("axis_sweep_1khz", {{"mappings", 1}, {"rate_hz", 1000}}, Scaled(1000),
+            [&](uint64_t n) {
+                std::atomic<bool> quit{false};
+                SyntheticInputSource source(n, 1, std::chrono::milliseconds(1), true);
+                source.run(*fixture.engine, quit);
+                return n;
+            }, 1);
+}
+
+static void BenchAxisNormalize() {
+    for (bool reverse : {false, true}) {
+        ControlMapping mapping = MakeConfig(1).mappings[0];
+        mapping.calibrationMinHid = -32768;
+        mapping.calibrationMaxHid = 32767;
+        mapping.reverseAxis = reverse;
+        RunCase("axis_normalize", {{"reverse", reverse}}, Scaled(50000000), [&](uint64_t n) {
+            uint64_t sum = 0;
+            for (uint64_t i = 0; i < n; ++i) {
+                sum += static_cast<uint64_t>(AxisToMidiValue(mapping, static_cast<LONG>(i % 70000) - 35000));
+            }
+            g_sink = g_sink + sum;
+            return n;
+        });
+    }
+}
+
+static void BenchMidiEncode() {
+    RunCase("midi_encode", {{"message", "control_change"}}, Scaled(100000000), [](uint64_t n) {
+        uint64_t sum = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            MidiMessage m = MidiMessage::controlChange(static_cast<int>(i & 15), static_cast<int>(i & 127),
+                                                       static_cast<int>((i >> 7) & 127));
+            sum += m.data()[0] + m.data()[1] + m.data()[2] + m.size();
+        }
+        g_sink = g_sink + sum;
+        return n;
+    });
+    RunCase("midi_encode", {{"message", "note_on_off"}}, Scaled(100000000), [](uint64_t n) {
+        uint64_t sum = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            MidiMessage m = (i & 1) ? MidiMessage::noteOn(static_cast<int>(i & 15), static_cast<int>(i & 127), 100)
+                                    : MidiMessage::noteOff(static_cast<int>(i & 15), static_cast<int>(i & 127));
+            sum += m.data()[0] + m.data()[1] + m.data()[2] + m.size();
+        }
+        g_sink = g_sink + sum;
+        return n;
+    });
+}
+
+// The same statement the dispatcher logs for every sent CC, at three logger states.
+// Logger::init() cannot be undone, so the states run from least to most enabled.
+static void BenchLogger() {
+    auto logCalls = [](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            LOG_DEBUG_S("Axis " << (i & 15) << ": CC Ch" << ((i & 15) + 1) << " CC" << (i & 127) << " Val" << ((i >> 7) & 127));
+        }
+        return n;
+    };
+    const int compiledMin = JOYSTICKMIDI_LOG_MIN_LEVEL;
+    RunCase("logger", {{"level", "uninitialized"}, {"message", "debug"}, {"compiled_min_level", compiledMin}},
+            Scaled(50000000), logCalls);
+    if (!Selected("logger")) return;
+    Logger::instance().init("INFO");
+    RunCase("logger", {{"level", "INFO"}, {"message", "debug"}, {"compiled_min_level", compiledMin}},
+            Scaled(50000000), logCalls);
+    Logger::instance().init("DEBUG");
+    RunCase("logger", {{"level", "DEBUG"}, {"message", "debug"}, {"compiled_min_level", compiledMin}},
+            Scaled(200000), logCalls);
+    Logger::instance().shutdown();
+}
+
+// One monitor refresh built by MonitorRenderer (terminal output excluded), with every row,
+// one row or no row changing between frames
+static void BenchMonitorRender() {
+    for (size_t mappings : {10, 100}) {
+        for (const char* activity : {"all", "one", "idle"}) {
+            EngineFixture fixture(mappings);
+            auto& states = fixture.engine->states();
+            for (size_t i = 0; i < states.size(); ++i) {
+                for (uint64_t ns = 1000; ns < 200000; ns += 1000 + i) states[i].latency->record(ns);
+            }
+            MonitorRenderer renderer;
+            renderer.reset(mappings);
+            renderer.render(fixture.config, states);
+            const std::string mode = activity;
+            uint64_t bytes = 0;
+            RunCase("monitor_render", {{"mappings", mappings}, {"changed", activity}}, Scaled(2000000 / mappings),
+                    [&](uint64_t n) {
+                        bytes = 0;
+                        for (uint64_t f = 0; f < n; ++f) {
+                            if (mode == "all") {
+                                for (size_t i = 0; i < states.size(); ++i) {
+                                    states[i].currentValue.store(static_cast<LONG>((f * 7 + i * 31) % 1024));
+                                }
+                            } else if (mode == "one") {
+                                const size_t i = f % states.size();
+                                states[i].currentValue.store(static_cast<LONG>((f * 7 + i * 31) % 1024));
+                            }
+                            renderer.render(fixture.config, states);
+                            bytes += renderer.frame().size();
+                        }
+                        return n;
+                    });
+            g_sink = g_sink + bytes;
+        }
+    }
+}
+
+// LoadConfiguration's work: read the file, parse it and convert to MidiMappingConfig
+static void BenchConfigLoad() {
+    if (!Selected("config_load")) return;
+    for (size_t mappings : {100, 1000, 10000}) {
+        const std::string path = "bench_" + std::to_string(mappings) + ".hidmidi.json";
+        {
+            std::ofstream ofs(path);
+            ofs << json(MakeConfig(mappings)).dump(4);
+        }
+        const uint64_t bytes = fs::file_size(path);
+        RunCase("config_load", {{"mappings", mappings}, {"bytes", bytes}}, Scaled(std::max<uint64_t>(5, 200000 / mappings)),
+                [&](uint64_t n) {
+                    for (uint64_t i = 0; i < n; ++i) {
+                        std::ifstream ifs(path);
+                        json j;
+                        ifs >> j;
+                        MidiMappingConfig config = j.get<MidiMappingConfig>();
+                        g_sink = g_sink + config.mappings.size();
+                    }
+                    return n;
+                });
+    }
+}
+
+static void PrintUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --filter NAME   Only run benchmarks whose name contains NAME\n"
+              << "  --repeat N      Runs per case (default 3); the fastest is reported\n"
+              << "  --scale F       Multiply iteration counts by F (e.g. 0.1 for a quick run)\n"
+              << "  -h, --help      Show this help\n";
+}
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            g_options.filter = argv[++i];
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            g_options.repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--scale" && i + 1 < argc) {
+            g_options.scale = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "-h" || arg == "--help") {
+            PrintUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Log files and generated configs go to a scratch directory that is removed afterwards
+    const fs::path originalDir = fs::current_path();
+    const fs::path workDir = fs::temp_directory_path() /
+        ("joystickmidi_bench_" + std::to_string(SteadyNowNs()));
+    fs::create_directories(workDir);
+    fs::current_path(workDir);
+
+    BenchDispatch();
+    BenchAxisSweep();
+    BenchAxisNormalize();
+    BenchMidiEncode();
+    BenchMonitorRender();
+    BenchConfigLoad();
+    BenchLogger();
+
+    fs::current_path(originalDir);
+    std::error_code ec;
+    fs::remove_all(workDir, ec);
+    return 0;
+}
@@ -14,6 +14,7 @@
 #include <filesystem>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
 
 // --- Platform-Specific Includes ---
 #ifdef _WIN32
@@ -30,6 +31,9 @@
     #include <hidpi.h>
     #include <setupapi.h>
     #include <wtypes.h>
+    #ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+    #define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004  // Windows 10+, missing from older SDKs
+    #endif
 #else // Linux
     #include <libudev.h>
     #include <fcntl.h>
@@ -39,9 +43,19 @@
     #include <string.h>
     #include <errno.h>
     #include <poll.h>
+    #include <sys/eventfd.h>
+    #include <sys/epoll.h>
+    #include <sys/stat.h>
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <termios.h>
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/mman.h>
+    #include <signal.h>
     #include <cstdint>
-    // Define LONG for Linux to match the Windows type used in shared code
-    typedef int32_t LONG;
     #define BITS_PER_LONG (sizeof(long) * 8)
 #endif
 
@@ -49,170 +63,63 @@
 #include "rtmidi/RtMidi.h"
 #include "third_party/nlohmann/json.hpp"
 #include "Logger.h"
+#include "MappingConfig.h"
+#include "MappingEngine.h"
+#include "InputSource.h"
+#include "InputRecorder.h"
+#include "MonitorView.h"
+#include "ControlChannel.h"
 
 // --- Namespaces and Constants ---
 using json = nlohmann::json;
 namespace fs = std::filesystem;
 const std::string CONFIG_EXTENSION = ".hidmidi.json";
 
-// --- Data Structures ---
-struct ControlInfo {
-    bool isButton = false;
-    LONG logicalMin = 0;
-    LONG logicalMax = 0;
-    std::string name = "Unknown Control";
-
-#ifdef _WIN32
-    USAGE usagePage = 0;
-    USAGE usage = 0;
-#else // Linux
-    uint16_t eventType = 0;
-    uint16_t eventCode = 0;
-#endif
-};
-
-enum class MidiMessageType { NONE, NOTE_ON_OFF, CC };
-
-struct ControlMapping {
-    ControlInfo control;
-    MidiMessageType midiMessageType = MidiMessageType::NONE;
-    int midiChannel = -1;  // -1 means use default channel
-    int midiNoteOrCCNumber = 0;
-    int midiValueNoteOnVelocity = 64;
-    int midiValueCCOn = 127;
-    int midiValueCCOff = 0;
-    LONG calibrationMinHid = 0;
-    LONG calibrationMaxHid = 0;
-    bool calibrationDone = false;
-    bool reverseAxis = false;
-};
+// --- Global State ---
+std::atomic<bool> g_quitFlag(false);
+std::unique_ptr<MidiSink> g_midiOut;  // Created in main() for the selected backend
+MidiMappingConfig g_currentConfig;
+std::thread g_inputThread;
+std::atomic<bool> g_inputStopFlag(false);  // Ends the input source; set by StopInputThread()/UpdateMappings()
+std::mutex g_consoleMutex;
 
-struct MidiMappingConfig {
-    std::string hidDevicePath;
-    std::string hidDeviceName;
-    std::string midiDeviceName;
-    int defaultMidiChannel = 0;
-    int midiSendIntervalMs = 1;
-    std::vector<ControlMapping> mappings;
-};
+// Mapping engine: turns published control values into MIDI on the dispatcher thread.
+// Attached to g_currentConfig and g_midiOut in main().
+MappingEngine g_engine;
+std::atomic<bool> g_snapshotRequested(false);  // Input thread should emit the full control state
 
-// --- JSON Serialization ---
-NLOHMANN_JSON_SERIALIZE_ENUM(MidiMessageType, {
-    {MidiMessageType::NONE, nullptr},
-    {MidiMessageType::NOTE_ON_OFF, "NoteOnOff"},
-    {MidiMessageType::CC, "CC"}
-})
-
-void to_json(json& j, const ControlInfo& ctrl) {
-    j = json{
-        {"isButton", ctrl.isButton}, {"logicalMin", ctrl.logicalMin},
-        {"logicalMax", ctrl.logicalMax}, {"name", ctrl.name}
-    };
+// Dispatcher wakeup: the input thread signals the MIDI dispatch loop directly so an
+// input event turns into a MIDI send without waiting for a polling interval.
 #ifdef _WIN32
-    j["usagePage"] = ctrl.usagePage;
-    j["usage"] = ctrl.usage;
+HANDLE g_dispatchEvent = nullptr;
 #else
-    j["eventType"] = ctrl.eventType;
-    j["eventCode"] = ctrl.eventCode;
+int g_dispatchEventFd = -1;
+int g_inputWakeFd = -1;  // Wakes the input thread for snapshot requests and shutdown
 #endif
-}
 
-void from_json(const json& j, ControlInfo& ctrl) {
-    j.at("isButton").get_to(ctrl.isButton);
-    j.at("logicalMin").get_to(ctrl.logicalMin);
-    j.at("logicalMax").get_to(ctrl.logicalMax);
-    j.at("name").get_to(ctrl.name);
+// Monitoring display: drawn by its own low-priority thread from the published mapping
+// state, so a slow or stalled terminal never holds up MIDI dispatch. The dispatcher only
+// raises g_monitorDirty (RequestMonitorRefresh()); an idle monitor thread stays blocked.
+bool g_monitorEnabled = true;  // --no-monitor
+int g_monitorHz = 60;          // --monitor-hz
+std::thread g_monitorThread;
+std::atomic<bool> g_monitorDirty(false);  // Some mapping changed since the last refresh
+bool g_monitorStop = false;               // Guarded by g_monitorMutex
+std::mutex g_monitorMutex;
+std::condition_variable g_monitorWake;
+
+// Control channel: terminal hotkeys (interactive runs) and an optional local socket are
+// served by a control thread. Commands that send MIDI reach the dispatcher through
+// g_controlMailbox, so the dispatch path itself never reads stdin or makes a syscall.
+ControlMailbox g_controlMailbox;
+std::thread g_controlThread;
 #ifdef _WIN32
-    ctrl.usagePage = j.value("usagePage", 0);
-    ctrl.usage = j.value("usage", 0);
+HANDLE g_controlStopEvent = nullptr;
 #else
-    ctrl.eventType = j.value("eventType", 0);
-    ctrl.eventCode = j.value("eventCode", 0);
+int g_controlWakeFd = -1;        // Stops the control thread
+std::string g_controlSocketPath; // --control-socket
+int g_controlListenFd = -1;
 #endif
-}
-
-void to_json(json& j, const ControlMapping& mapping) {
-    j = json{
-        {"control", mapping.control},
-        {"midiMessageType", mapping.midiMessageType},
-        {"midiChannel", mapping.midiChannel},
-        {"midiNoteOrCCNumber", mapping.midiNoteOrCCNumber},
-        {"midiValueNoteOnVelocity", mapping.midiValueNoteOnVelocity},
-        {"midiValueCCOn", mapping.midiValueCCOn},
-        {"midiValueCCOff", mapping.midiValueCCOff},
-        {"calibrationMinHid", mapping.calibrationMinHid},
-        {"calibrationMaxHid", mapping.calibrationMaxHid},
-        {"calibrationDone", mapping.calibrationDone},
-        {"reverseAxis", mapping.reverseAxis}
-    };
-}
-
-void from_json(const json& j, ControlMapping& mapping) {
-    j.at("control").get_to(mapping.control);
-    j.at("midiMessageType").get_to(mapping.midiMessageType);
-    mapping.midiChannel = j.value("midiChannel", -1);
-    j.at("midiNoteOrCCNumber").get_to(mapping.midiNoteOrCCNumber);
-    mapping.midiValueNoteOnVelocity = j.value("midiValueNoteOnVelocity", 64);
-    mapping.midiValueCCOn = j.value("midiValueCCOn", 127);
-    mapping.midiValueCCOff = j.value("midiValueCCOff", 0);
-    mapping.calibrationMinHid = j.value("calibrationMinHid", 0);
-    mapping.calibrationMaxHid = j.value("calibrationMaxHid", 0);
-    mapping.calibrationDone = j.value("calibrationDone", false);
-    mapping.reverseAxis = j.value("reverseAxis", false);
-}
-
-void to_json(json& j, const MidiMappingConfig& cfg) {
-    j = json{
-        {"hidDevicePath", cfg.hidDevicePath},
-        {"hidDeviceName", cfg.hidDeviceName},
-        {"midiDeviceName", cfg.midiDeviceName},
-        {"defaultMidiChannel", cfg.defaultMidiChannel},
-        {"midiSendIntervalMs", cfg.midiSendIntervalMs},
-        {"mappings", cfg.mappings}
-    };
-}
-
-void from_json(const json& j, MidiMappingConfig& cfg) {
-    j.at("hidDevicePath").get_to(cfg.hidDevicePath);
-    j.at("hidDeviceName").get_to(cfg.hidDeviceName);
-    j.at("midiDeviceName").get_to(cfg.midiDeviceName);
-    cfg.defaultMidiChannel = j.value("defaultMidiChannel", 0);
-    cfg.midiSendIntervalMs = j.value("midiSendIntervalMs", 1);
-    j.at("mappings").get_to(cfg.mappings);
-}
-
-// --- Global State ---
-std::atomic<bool> g_quitFlag(false);
-RtMidiOut g_midiOut;
-MidiMappingConfig g_currentConfig;
-std::thread g_inputThread;
-std::mutex g_consoleMutex;
-
-// Per-mapping state tracking
-struct MappingState {
-    std::atomic<LONG> currentValue{0};
-    std::atomic<bool> valueChanged{false};
-    LONG previousValue = -1;
-    int lastSentMidiValue = -1;
-
-    MappingState() = default;
-    MappingState(MappingState&& other) noexcept
-        : currentValue(other.currentValue.load()),
-          valueChanged(other.valueChanged.load()),
-          previousValue(other.previousValue),
-          lastSentMidiValue(other.lastSentMidiValue) {}
-    MappingState& operator=(MappingState&& other) noexcept {
-        currentValue = other.currentValue.load();
-        valueChanged = other.valueChanged.load();
-        previousValue = other.previousValue;
-        lastSentMidiValue = other.lastSentMidiValue;
-        return *this;
-    }
-    MappingState(const MappingState&) = delete;
-    MappingState& operator=(const MappingState&) = delete;
-};
-std::vector<MappingState> g_mappingStates;
-std::mutex g_mappingStatesMutex;
 
 // --- Forward Declarations ---
 void ClearScreen();
@@ -227,6 +134,12 @@ bool PerformCalibration(size_t mappingIndex);
 void ConfigureMappingMidi(ControlMapping& mapping, int defaultChannel);
 void InitializeMappingStates();
 bool EditConfiguration(std::vector<ControlInfo>& available_controls);
+bool InitDispatchSignal();
+void SignalDispatcher();
+void WakeInputThread();
+void CloseDispatchSignal();
+void StopInputThread();
+int RunMonitoring(bool interactive);
 
 // ===================================================================================
 //
@@ -479,6 +392,38 @@ std::vector<ControlInfo> GetAvailableControls(PHIDP_PREPARSED_DATA pData, HIDP_C
 HWND g_messageWindow = nullptr;
 RAWINPUTDEVICE g_rid;
 PHIDP_PREPARSED_DATA g_preparsedData = nullptr;
+MappingEngine* g_rawInputEngine = nullptr;  // Engine of the running RawInputSource (WindowProc has no context)
+
+// The preparsed data of the selected device outlives the input thread, which is restarted
+// for mapping edits; it is replaced when another device is selected and freed at exit.
+void FreePreparsedData() {
+    if (g_preparsedData) HeapFree(GetProcessHeap(), 0, g_preparsedData);
+    g_preparsedData = nullptr;
+}
+
+void SetPreparsedData(PHIDP_PREPARSED_DATA data) {
+    static bool freeAtExit = false;
+    if (!freeAtExit) {
+        std::atexit(FreePreparsedData);
+        freeAtExit = true;
+    }
+    FreePreparsedData();
+    g_preparsedData = data;
+}
+
+// Set by RawInputSource::run() once its window exists (or could not be created), because
+// JoinInputThread() stops the thread by posting to that window
+bool g_inputWindowReady = false;  // Guarded by g_inputWindowMutex
+std::mutex g_inputWindowMutex;
+std::condition_variable g_inputWindowCreated;
+
+void SignalInputWindowReady() {
+    {
+        std::lock_guard<std::mutex> lock(g_inputWindowMutex);
+        g_inputWindowReady = true;
+    }
+    g_inputWindowCreated.notify_all();
+}
 
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
     if (uMsg == WM_INPUT) {
@@ -488,11 +433,12 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         if (GetRawInputData((HRAWINPUT)lParam, RID_INPUT, lpb.get(), &dwSize, sizeof(RAWINPUTHEADER)) != dwSize) return 0;
 
         RAWINPUT* raw = (RAWINPUT*)lpb.get();
-        if (raw->header.dwType == RIM_TYPEHID && g_preparsedData) {
+        if (raw->header.dwType == RIM_TYPEHID && g_preparsedData && g_rawInputEngine) {
+            bool anyChanged = false;
             // Process all mapped controls
-            for (size_t i = 0; i < g_currentConfig.mappings.size() && i < g_mappingStates.size(); ++i) {
+            MappingEngine& engine = *g_rawInputEngine;
+            for (size_t i = 0; i < g_currentConfig.mappings.size() && i < engine.states().size(); ++i) {
                 const auto& mapping = g_currentConfig.mappings[i];
-                auto& state = g_mappingStates[i];
                 ULONG value = 0;
 
                 if (mapping.control.isButton) {
@@ -507,23 +453,35 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                     HidP_GetUsageValue(HidP_Input, mapping.control.usagePage, 0, mapping.control.usage, &value, g_preparsedData, (PCHAR)raw->data.hid.bRawData, raw->data.hid.dwSizeHid);
                 }
 
-                if (static_cast<LONG>(value) != state.currentValue.load()) {
-                    state.currentValue = value;
-                    state.valueChanged = true;
-                }
+                if (engine.publish(i, static_cast<LONG>(value))) anyChanged = true;
             }
+            // One raw input report is one frame
+            engine.commitFrame(anyChanged);
         }
         return DefWindowProc(hwnd, uMsg, wParam, lParam);
     }
     if (uMsg == WM_DESTROY) {
-        g_quitFlag = true;
+        // Destroyed at the end of run(); only an unrequested stop ends the application
+        if (!g_inputStopFlag) {
+            g_quitFlag = true;
+            SignalDispatcher();
+        }
         PostQuitMessage(0);
         return 0;
     }
     return DefWindowProc(hwnd, uMsg, wParam, lParam);
 }
 
-void InputMonitorLoop() {
+// Windows raw input: a message-only window receives WM_INPUT reports for joysticks and
+// gamepads; every report is one frame.
+class RawInputSource : public InputSource {
+public:
+    const char* sourceName() const override { return "rawinput"; }
+    void run(MappingEngine& engine, const std::atomic<bool>& quit) override;
+};
+
+void RawInputSource::run(MappingEngine& engine, const std::atomic<bool>& quit) {
+    g_rawInputEngine = &engine;
     LOG_DEBUG("Setting up Windows raw input message window");
     WNDCLASS wc = {};
     wc.lpfnWndProc = WindowProc;
@@ -531,12 +489,15 @@ void InputMonitorLoop() {
     wc.lpszClassName = L"JoystickMidiListener";
     if (!RegisterClass(&wc)) {
         LOG_ERROR("Failed to register window class");
+        SignalInputWindowReady();
         return;
     }
 
     g_messageWindow = CreateWindowEx(0, wc.lpszClassName, L"Listener", 0, 0, 0, 0, 0, HWND_MESSAGE, NULL, NULL, NULL);
+    SignalInputWindowReady();
     if (!g_messageWindow) {
         LOG_ERROR("Failed to create message window");
+        UnregisterClass(wc.lpszClassName, wc.hInstance);
         return;
     }
     LOG_INFO("Input monitor thread started");
@@ -550,15 +511,16 @@ void InputMonitorLoop() {
     RegisterRawInputDevices(&g_rid, 1, sizeof(g_rid));
 
     MSG msg;
-    while (!g_quitFlag && GetMessage(&msg, NULL, 0, 0)) {
+    while (!quit && GetMessage(&msg, NULL, 0, 0)) {
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
 
     LOG_INFO("Input monitor thread stopped");
-    if (g_preparsedData) HeapFree(GetProcessHeap(), 0, g_preparsedData);
     if (g_messageWindow) DestroyWindow(g_messageWindow);
+    g_messageWindow = nullptr;
     UnregisterClass(L"JoystickMidiListener", GetModuleHandle(NULL));
+    g_rawInputEngine = nullptr;
 }
 
 #else // --- Linux Implementation ---
@@ -566,8 +528,49 @@ void InputMonitorLoop() {
 struct HidDeviceInfo {
     std::string name;
     std::string path;
+    DeviceIdentity identity;
 };
 
+// Collects the stable identifiers udev knows for an evdev node
+DeviceIdentity IdentityFromUdevDevice(struct udev_device* dev) {
+    DeviceIdentity identity;
+    auto prop = [dev](const char* key) {
+        const char* value = udev_device_get_property_value(dev, key);
+        return std::string(value ? value : "");
+    };
+    identity.vendorId = prop("ID_VENDOR_ID");
+    identity.productId = prop("ID_MODEL_ID");
+    identity.serial = prop("ID_SERIAL");
+
+    struct udev_device* parent = udev_device_get_parent_with_subsystem_devtype(dev, "input", NULL);
+    if (parent) {
+        // Bluetooth and other non-USB devices only expose their IDs on the input parent
+        auto sysattr = [parent](const char* key) {
+            const char* value = udev_device_get_sysattr_value(parent, key);
+            return std::string(value ? value : "");
+        };
+        if (identity.vendorId.empty()) identity.vendorId = sysattr("id/vendor");
+        if (identity.productId.empty()) identity.productId = sysattr("id/product");
+        identity.phys = sysattr("phys");
+    }
+
+    struct udev_list_entry* link;
+    udev_list_entry_foreach(link, udev_device_get_devlinks_list_entry(dev)) {
+        const char* linkPath = udev_list_entry_get_name(link);
+        if (linkPath && strncmp(linkPath, "/dev/input/by-id/", 17) == 0) {
+            identity.byIdPath = linkPath;
+            break;
+        }
+    }
+    return identity;
+}
+
+// evdev event nodes only; the joydev (jsN) and mousedev (mouseN) nodes of the same device
+// share its identity but speak a different protocol
+bool IsEventDevnode(const char* devnode) {
+    return devnode && strncmp(devnode, "/dev/input/event", 16) == 0;
+}
+
 std::vector<HidDeviceInfo> EnumerateHidDevices() {
     std::vector<HidDeviceInfo> found_devices;
     struct udev *udev = udev_new();
@@ -595,12 +598,13 @@ std::vector<HidDeviceInfo> EnumerateHidDevices() {
         const char* is_joystick = udev_device_get_property_value(dev, "ID_INPUT_JOYSTICK");
         if (is_joystick && strcmp(is_joystick, "1") == 0) {
             const char* dev_node = udev_device_get_devnode(dev);
-            if (dev_node && (std::string(dev_node).find("/dev/input/event") != std::string::npos)) {
+            if (IsEventDevnode(dev_node)) {
                 HidDeviceInfo info;
                 info.path = dev_node;
                 const char* name = udev_device_get_property_value(dev, "ID_MODEL_FROM_DATABASE");
                 if (!name) name = udev_device_get_property_value(dev, "NAME");
                 info.name = name ? name : "Unnamed Joystick";
+                info.identity = IdentityFromUdevDevice(dev);
                 found_devices.push_back(info);
             }
         }
@@ -612,7 +616,119 @@ std::vector<HidDeviceInfo> EnumerateHidDevices() {
     return found_devices;
 }
 
-std::vector<ControlInfo> GetAvailableControls(const std::string& devicePath) {
+// Targeted udev lookup of a single device node (no enumeration)
+bool QueryDeviceIdentity(const std::string& devnode, DeviceIdentity& identity) {
+    struct stat st;
+    if (stat(devnode.c_str(), &st) != 0 || !S_ISCHR(st.st_mode)) return false;
+    struct udev* udev = udev_new();
+    if (!udev) return false;
+    struct udev_device* dev = udev_device_new_from_devnum(udev, 'c', st.st_rdev);
+    if (dev) {
+        identity = IdentityFromUdevDevice(dev);
+        udev_device_unref(dev);
+    }
+    udev_unref(udev);
+    return dev != nullptr;
+}
+
+// 0 = different device, 1 = same model (vendor/product only), 2 = same physical unit
+int MatchDeviceIdentity(const DeviceIdentity& expected, const DeviceIdentity& actual) {
+    if (expected.vendorId != actual.vendorId || expected.productId != actual.productId) return 0;
+    if (!expected.serial.empty() && !actual.serial.empty()) return expected.serial == actual.serial ? 2 : 0;
+    if (!expected.phys.empty() && expected.phys == actual.phys) return 2;
+    return 1;
+}
+
+// Score a hotplugged node needs to be taken for a configured device: a saved unique ID
+// or physical path must match, so one of two identical sticks is never mistaken for the
+// other; otherwise the model is all there is to compare
+int RequiredIdentityMatch(const DeviceIdentity& expected) {
+    return (!expected.serial.empty() || !expected.phys.empty()) ? 2 : 1;
+}
+
+// --- Device identity cache ---
+// Remembers which event node each identity resolved to last time, so startup normally
+// needs a single targeted lookup instead of a full udev enumeration.
+const std::string DEVICE_CACHE_FILE = ".joystickmidi_devices.json";
+
+std::string DeviceIdentityKey(const DeviceIdentity& identity) {
+    return identity.vendorId + ":" + identity.productId + ":" + identity.serial + ":" + identity.phys;
+}
+
+json LoadDeviceCache() {
+    try {
+        std::ifstream ifs(DEVICE_CACHE_FILE);
+        if (ifs.is_open()) {
+            json j;
+            ifs >> j;
+            if (j.is_object()) return j;
+        }
+    } catch (const std::exception& e) {
+        LOG_WARN_S("Ignoring unreadable device cache: " << e.what());
+    }
+    return json::object();
+}
+
+void SaveDeviceCache(const json& cache) {
+    std::ofstream ofs(DEVICE_CACHE_FILE);
+    if (ofs.is_open()) ofs << std::setw(4) << cache << std::endl;
+}
+
+// Finds the current event node for a configured device: cached node, by-id symlink and
+// last known path are verified in turn before falling back to a full enumeration.
+// Updates dev.path (and fills in the identity of legacy path-only configs).
+bool ResolveDevicePath(InputDeviceConfig& dev) {
+    DeviceIdentity actual;
+    if (dev.identity.empty()) {
+        // Path-only config: use the stored path and record its identity for next time
+        if (!QueryDeviceIdentity(dev.path, actual)) return false;
+        dev.identity = actual;
+        return true;
+    }
+
+    json cache = LoadDeviceCache();
+    const std::string key = DeviceIdentityKey(dev.identity);
+    std::vector<std::string> candidates;
+    if (cache.contains(key) && cache[key].is_string()) candidates.push_back(cache[key].get<std::string>());
+    if (!dev.identity.byIdPath.empty()) {
+        std::error_code ec;
+        auto target = fs::canonical(dev.identity.byIdPath, ec);
+        if (!ec) candidates.push_back(target.string());
+    }
+    candidates.push_back(dev.path);
+
+    std::string resolved;
+    for (const auto& candidate : candidates) {
+        if (QueryDeviceIdentity(candidate, actual) && MatchDeviceIdentity(dev.identity, actual) == 2) {
+            resolved = candidate;
+            break;
+        }
+    }
+    if (resolved.empty()) {
+        // Full scan: prefer an exact unit match, otherwise accept a unique model match
+        LOG_DEBUG_S("Device identity cache miss for " << dev.name << ", enumerating");
+        std::vector<std::string> modelMatches;
+        for (const auto& info : EnumerateHidDevices()) {
+            int score = MatchDeviceIdentity(dev.identity, info.identity);
+            if (score == 2) { resolved = info.path; break; }
+            if (score == 1) modelMatches.push_back(info.path);
+        }
+        if (resolved.empty() && modelMatches.size() == 1) resolved = modelMatches[0];
+    }
+    if (resolved.empty()) return false;
+
+    if (resolved != dev.path) {
+        LOG_INFO_S("Resolved " << dev.name << " to " << resolved << " (was " << dev.path << ")");
+        dev.path = resolved;
+    }
+    if (!cache.contains(key) || cache[key] != resolved) {
+        cache[key] = resolved;
+        SaveDeviceCache(cache);
+    }
+    return true;
+}
+
+std::vector<ControlInfo> GetAvailableControls(const std::string& devicePath, size_t deviceIndex = 0) {
     std::vector<ControlInfo> controls;
     int fd = open(devicePath.c_str(), O_RDONLY);
     if (fd < 0) return controls;
@@ -625,11 +741,12 @@ std::vector<ControlInfo> GetAvailableControls(const std::string& devicePath) {
     };
 
     if (test_bit(EV_KEY, ev_bits)) {
-        unsigned long key_bits[KEY_MAX / BITS_PER_LONG + 1] = {0};
+        unsigned long key_bits[KEY_CNT / BITS_PER_LONG + 1] = {0};
         ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(key_bits)), key_bits);
-        for (int code = BTN_JOYSTICK; code < KEY_MAX; ++code) {
+        for (int code = BTN_JOYSTICK; code < KEY_CNT; ++code) {
             if (test_bit(code, key_bits)) {
                 ControlInfo ctrl;
+                ctrl.deviceIndex = deviceIndex;
                 ctrl.isButton = true; ctrl.eventType = EV_KEY; ctrl.eventCode = code;
                 ctrl.logicalMin = 0; ctrl.logicalMax = 1;
                 ctrl.name = "Button " + std::to_string(code - BTN_JOYSTICK);
@@ -638,13 +755,14 @@ std::vector<ControlInfo> GetAvailableControls(const std::string& devicePath) {
         }
     }
     if (test_bit(EV_ABS, ev_bits)) {
-        unsigned long abs_bits[ABS_MAX / BITS_PER_LONG + 1] = {0};
+        unsigned long abs_bits[ABS_CNT / BITS_PER_LONG + 1] = {0};
         ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(abs_bits)), abs_bits);
-        for (int code = 0; code < ABS_MAX; ++code) {
+        for (int code = 0; code < ABS_CNT; ++code) {
             if (test_bit(code, abs_bits)) {
                 struct input_absinfo abs_info;
                 if (ioctl(fd, EVIOCGABS(code), &abs_info) >= 0) {
                     ControlInfo ctrl;
+                    ctrl.deviceIndex = deviceIndex;
                     ctrl.isButton = false; ctrl.eventType = EV_ABS; ctrl.eventCode = code;
                     ctrl.logicalMin = abs_info.minimum; ctrl.logicalMax = abs_info.maximum;
                     ctrl.name = "Axis " + std::to_string(code);
@@ -657,44 +775,566 @@ std::vector<ControlInfo> GetAvailableControls(const std::string& devicePath) {
     return controls;
 }
 
-void InputMonitorLoop() {
-    LOG_DEBUG_S("Opening device for input monitoring: " << g_currentConfig.hidDevicePath);
-    int fd = open(g_currentConfig.hidDevicePath.c_str(), O_RDONLY | O_NONBLOCK);
-    if (fd < 0) {
-        std::lock_guard<std::mutex> lock(g_consoleMutex);
-        std::cerr << "\nError: Could not open device " << g_currentConfig.hidDevicePath << " in input thread. " << strerror(errno) << std::endl;
-        LOG_ERROR_S("Could not open device " << g_currentConfig.hidDevicePath << ": " << strerror(errno));
+// --- (type, code) -> mapping lookup ---
+// Flat table indexed by EV_KEY / EV_ABS code so the input thread finds the mappings for an
+// event in constant time. Mappings for slot s are indices[start[s] .. start[s + 1]), which
+// allows several mappings to share one control.
+struct MappingDispatchTable {
+    static constexpr size_t SLOT_COUNT = KEY_CNT + ABS_CNT;
+    std::vector<uint16_t> start = std::vector<uint16_t>(SLOT_COUNT + 1, 0);
+    std::vector<uint16_t> indices;
+
+    static int slotFor(uint16_t type, uint16_t code) {
+        if (type == EV_KEY && code < KEY_CNT) return code;
+        if (type == EV_ABS && code < ABS_CNT) return KEY_CNT + code;
+        return -1;
+    }
+};
+
+// One table per configured input device, rebuilt by InitializeMappingStates() and swapped
+// atomically so the input thread never sees a half-built table.
+using MappingDispatchTables = std::vector<MappingDispatchTable>;
+std::shared_ptr<const MappingDispatchTables> g_mappingDispatchTables;
+
+void BuildMappingDispatchTables() {
+    auto tables = std::make_shared<MappingDispatchTables>(std::max<size_t>(1, g_currentConfig.devices.size()));
+    const auto& mappings = g_currentConfig.mappings;
+    size_t mappingCount = std::min<size_t>(mappings.size(), std::numeric_limits<uint16_t>::max());
+
+    for (size_t device = 0; device < tables->size(); ++device) {
+        auto& table = (*tables)[device];
+        auto slot_of = [&](size_t i) {
+            const auto& ctrl = mappings[i].control;
+            return ctrl.deviceIndex == device ? MappingDispatchTable::slotFor(ctrl.eventType, ctrl.eventCode) : -1;
+        };
+
+        // Counting sort of mapping indices by slot
+        std::vector<uint16_t> counts(MappingDispatchTable::SLOT_COUNT, 0);
+        for (size_t i = 0; i < mappingCount; ++i) {
+            int slot = slot_of(i);
+            if (slot >= 0) counts[slot]++;
+        }
+        for (size_t slot = 0; slot < MappingDispatchTable::SLOT_COUNT; ++slot) {
+            table.start[slot + 1] = table.start[slot] + counts[slot];
+        }
+        table.indices.resize(table.start[MappingDispatchTable::SLOT_COUNT]);
+        std::vector<uint16_t> fill(table.start.begin(), table.start.end() - 1);
+        for (size_t i = 0; i < mappingCount; ++i) {
+            int slot = slot_of(i);
+            if (slot >= 0) table.indices[fill[slot]++] = static_cast<uint16_t>(i);
+        }
+    }
+
+    std::atomic_store(&g_mappingDispatchTables, std::shared_ptr<const MappingDispatchTables>(std::move(tables)));
+}
+
+// Installs an evdev event mask (EVIOCSMASK) so the kernel only delivers the EV_KEY/EV_ABS
+// codes present in the dispatch table; unmapped sensors, touchpads and EV_MSC no longer wake
+// the input thread. EV_SYN is never filtered by the kernel. Returns false if unsupported.
+bool ApplyEventMask(int fd, const MappingDispatchTable& table) {
+    auto set_bit = [](int bit, unsigned long* array) {
+        array[bit / BITS_PER_LONG] |= 1UL << (bit % BITS_PER_LONG);
+    };
+    unsigned long type_bits[EV_CNT / BITS_PER_LONG + 1] = {0};
+    unsigned long key_bits[KEY_CNT / BITS_PER_LONG + 1] = {0};
+    unsigned long abs_bits[ABS_CNT / BITS_PER_LONG + 1] = {0};
+    size_t keyCount = 0, absCount = 0;
+
+    for (int code = 0; code < KEY_CNT; ++code) {
+        int slot = MappingDispatchTable::slotFor(EV_KEY, code);
+        if (table.start[slot + 1] > table.start[slot]) { set_bit(code, key_bits); keyCount++; }
+    }
+    for (int code = 0; code < ABS_CNT; ++code) {
+        int slot = MappingDispatchTable::slotFor(EV_ABS, code);
+        if (table.start[slot + 1] > table.start[slot]) { set_bit(code, abs_bits); absCount++; }
+    }
+    if (keyCount > 0) set_bit(EV_KEY, type_bits);
+    if (absCount > 0) set_bit(EV_ABS, type_bits);
+
+    auto set_mask = [fd](unsigned int type, const unsigned long* bits, size_t size) {
+        struct input_mask mask;
+        mask.type = type;
+        mask.codes_size = static_cast<__u32>(size);
+        mask.codes_ptr = reinterpret_cast<__u64>(bits);
+        return ioctl(fd, EVIOCSMASK, &mask) == 0;
+    };
+    // Per-code masks first, then the type mask that enables them
+    if (!set_mask(EV_KEY, key_bits, sizeof(key_bits)) ||
+        !set_mask(EV_ABS, abs_bits, sizeof(abs_bits)) ||
+        !set_mask(0, type_bits, sizeof(type_bits))) {
+        return false;
+    }
+    LOG_DEBUG_S("Event mask installed: " << keyCount << " key code(s), " << absCount << " abs code(s)");
+    return true;
+}
+
+// Kernel event time in nanoseconds. Devices are switched to CLOCK_MONOTONIC, the clock
+// behind std::chrono::steady_clock, so this is directly comparable with SteadyNowNs().
+// Synthesized events (resync) carry no time and return 0, i.e. "now".
+uint64_t EventTimestampNs(const struct input_event& ev) {
+    return static_cast<uint64_t>(ev.input_event_sec) * 1000000000ull +
+           static_cast<uint64_t>(ev.input_event_usec) * 1000ull;
+}
+
+// Applies one SYN_REPORT-delimited frame of raw events to the mappings and commits it.
+void ApplyInputFrame(MappingEngine& engine, const MappingDispatchTable& table, const std::vector<struct input_event>& frame,
+                     bool snapshot = false) {
+    bool anyChanged = false;
+    for (const auto& ev : frame) {
+        int slot = MappingDispatchTable::slotFor(ev.type, ev.code);
+        if (slot < 0) continue;
+        const uint64_t timestampNs = EventTimestampNs(ev);
+        for (uint16_t k = table.start[slot]; k < table.start[slot + 1]; ++k) {
+            uint16_t i = table.indices[k];
+            if (i < engine.states().size() && engine.publish(i, static_cast<LONG>(ev.value), snapshot, timestampNs)) {
+                anyChanged = true;
+            }
+        }
+    }
+    engine.commitFrame(anyChanged);
+}
+
+// --- Input recording (--record / --replay) ---
+std::string g_recordPath;
+std::string g_replayPath;
+bool g_replayAsFastAsPossible = false;
+std::unique_ptr<InputRecordWriter> g_inputRecorder;  // Only used by the input thread
+
+void RecordInputEvent(size_t deviceIndex, uint64_t timestampNs, const struct input_event& ev, bool snapshot = false) {
+    InputRecord record;
+    record.timestampNs = timestampNs;
+    record.device = static_cast<uint32_t>(deviceIndex);
+    record.type = ev.type;
+    record.code = ev.code;
+    record.value = ev.value;
+    record.snapshot = snapshot;
+    g_inputRecorder->write(record);
+}
+
+// Reads the current state of every mapped key/axis with EVIOCGKEY/EVIOCGABS and applies it
+// as one frame. For a resync, unchanged controls are skipped by MappingEngine::publish() so only
+// differences reach the dispatcher; a snapshot emits every control's state.
+void ResyncDeviceState(MappingEngine& engine, int fd, size_t deviceIndex, const MappingDispatchTable& table, bool snapshot = false) {
+    unsigned long key_bits[KEY_CNT / BITS_PER_LONG + 1] = {0};
+    bool haveKeys = ioctl(fd, EVIOCGKEY(sizeof(key_bits)), key_bits) >= 0;
+
+    std::vector<struct input_event> frame;
+    for (int code = 0; code < KEY_CNT && haveKeys; ++code) {
+        int slot = MappingDispatchTable::slotFor(EV_KEY, code);
+        if (table.start[slot + 1] == table.start[slot]) continue;
+        struct input_event ev = {};
+        ev.type = EV_KEY;
+        ev.code = code;
+        ev.value = (key_bits[code / BITS_PER_LONG] >> (code % BITS_PER_LONG)) & 1;
+        frame.push_back(ev);
+    }
+    for (int code = 0; code < ABS_CNT; ++code) {
+        int slot = MappingDispatchTable::slotFor(EV_ABS, code);
+        if (table.start[slot + 1] == table.start[slot]) continue;
+        struct input_absinfo abs_info;
+        if (ioctl(fd, EVIOCGABS(code), &abs_info) < 0) continue;
+        struct input_event ev = {};
+        ev.type = EV_ABS;
+        ev.code = code;
+        ev.value = abs_info.value;
+        frame.push_back(ev);
+    }
+    if (g_inputRecorder) {
+        // Recorded as a regular frame so a replay reproduces the resynced state
+        uint64_t now = SteadyNowNs();
+        for (const auto& ev : frame) RecordInputEvent(deviceIndex, now, ev, snapshot);
+        struct input_event report = {};
+        report.type = EV_SYN;
+        report.code = SYN_REPORT;
+        RecordInputEvent(deviceIndex, now, report, snapshot);
+    }
+    ApplyInputFrame(engine, table, frame, snapshot);
+}
+
+// --- Multi-device input engine ---
+// All configured evdev devices are served by the single input thread through one epoll
+// set; each device has its own dispatch table, event mask and frame buffer.
+struct InputDevice {
+    size_t index = 0;
+    std::string path;
+    int fd = -1;
+    std::shared_ptr<const MappingDispatchTables> maskedTables;  // Tables the event mask was derived from
+    bool eventMaskSupported = true;
+    bool dropping = false;  // Between SYN_DROPPED and the next SYN_REPORT
+    bool kernelTimestamps = false;  // Event times are on CLOCK_MONOTONIC
+    std::vector<struct input_event> frame;
+    std::chrono::steady_clock::time_point disconnectedAt;
+};
+
+const uint64_t INPUT_WAKE_TOKEN = std::numeric_limits<uint64_t>::max();
+const uint64_t INPUT_UDEV_TOKEN = std::numeric_limits<uint64_t>::max() - 1;
+
+bool OpenInputDevice(InputDevice& dev, int epollFd, bool reportErrors = true) {
+    LOG_DEBUG_S("Opening device for input monitoring: " << dev.path);
+    dev.fd = open(dev.path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (dev.fd < 0) {
+        if (reportErrors) {
+            std::lock_guard<std::mutex> lock(g_consoleMutex);
+            std::cerr << "\nError: Could not open device " << dev.path << " in input thread. " << strerror(errno) << std::endl;
+        }
+        LOG_ERROR_S("Could not open device " << dev.path << ": " << strerror(errno));
+        return false;
+    }
+    // Timestamp events on the monotonic clock (default is CLOCK_REALTIME) for latency tracking
+    int clockId = CLOCK_MONOTONIC;
+    if (ioctl(dev.fd, EVIOCSCLOCKID, &clockId) < 0) {
+        LOG_WARN_S("EVIOCSCLOCKID failed on " << dev.path << ", latency is measured from read time: " << strerror(errno));
+        dev.kernelTimestamps = false;
+    } else {
+        dev.kernelTimestamps = true;
+    }
+    struct epoll_event epev = {};
+    epev.events = EPOLLIN;
+    epev.data.u64 = dev.index;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, dev.fd, &epev);
+    dev.maskedTables.reset();
+    dev.eventMaskSupported = true;
+    dev.dropping = false;
+    dev.frame.clear();
+    return true;
+}
+
+void CloseInputDevice(InputDevice& dev, int epollFd) {
+    if (dev.fd < 0) return;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, dev.fd, nullptr);
+    close(dev.fd);
+    dev.fd = -1;
+}
+
+// Drains one device with batched reads and applies every complete SYN_REPORT frame.
+// Returns false if the device has gone away.
+bool ReadInputDevice(MappingEngine& engine, InputDevice& dev, const MappingDispatchTable& table) {
+    const size_t READ_BATCH_EVENTS = 64;
+    const size_t MAX_FRAME_EVENTS = 512;
+    struct input_event batch[READ_BATCH_EVENTS];
+
+    while (true) {
+        ssize_t bytes = read(dev.fd, batch, sizeof(batch));
+        if (bytes < 0 && errno == EINTR) continue;
+        if (bytes < 0 && errno == ENODEV) return false;
+        if (bytes <= 0) break;  // EAGAIN: drained
+
+        size_t count = static_cast<size_t>(bytes) / sizeof(struct input_event);
+        const uint64_t readNs = g_inputRecorder && !dev.kernelTimestamps ? SteadyNowNs() : 0;
+        for (size_t e = 0; e < count; ++e) {
+            const auto& ev = batch[e];
+            // Recorded as it is applied so a resync frame lands right after the SYN_REPORT that triggered it
+            if (g_inputRecorder) RecordInputEvent(dev.index, dev.kernelTimestamps ? EventTimestampNs(ev) : readNs, ev);
+            if (ev.type == EV_SYN) {
+                if (ev.code == SYN_DROPPED) {
+                    // Kernel buffer overrun: the partial frame is unreliable
+                    uint64_t drops = engine.stats().synDropped.fetch_add(1, std::memory_order_relaxed) + 1;
+                    LOG_WARN_S("SYN_DROPPED received on " << dev.path << " (" << drops << " total), resyncing device state");
+                    dev.frame.clear();
+                    dev.dropping = true;
+                } else if (ev.code == SYN_REPORT) {
+                    if (dev.dropping) {
+                        dev.dropping = false;
+                        ResyncDeviceState(engine, dev.fd, dev.index, table);
+                    } else if (!dev.frame.empty()) {
+                        ApplyInputFrame(engine, table, dev.frame);
+                    }
+                    dev.frame.clear();
+                }
+                continue;
+            }
+            if (dev.dropping) continue;
+            // Oversized frames are applied in parts rather than growing without bound
+            if (dev.frame.size() == MAX_FRAME_EVENTS) {
+                ApplyInputFrame(engine, table, dev.frame);
+                dev.frame.clear();
+            }
+            dev.frame.push_back(ev);
+            if (!dev.kernelTimestamps) {
+                dev.frame.back().input_event_sec = 0;  // CLOCK_REALTIME: not comparable, use read time
+                dev.frame.back().input_event_usec = 0;
+            }
+        }
+        if (static_cast<size_t>(bytes) < sizeof(batch)) break;
+    }
+    return true;
+}
+
+// Releases every pressed button of a device that disappeared so no note is left hanging.
+// Axes keep their last value.
+void ReleaseDeviceButtons(MappingEngine& engine, const MappingDispatchTable& table) {
+    bool anyChanged = false;
+    for (uint16_t i : table.indices) {
+        if (i < engine.states().size() && engine.mappingAt(i).control.isButton &&
+            engine.publish(i, 0)) {
+            anyChanged = true;
+        }
+    }
+    engine.commitFrame(anyChanged);
+}
+
+void HandleDeviceRemoved(MappingEngine& engine, InputDevice& dev, int epollFd, const MappingDispatchTable& table) {
+    CloseInputDevice(dev, epollFd);
+    dev.disconnectedAt = std::chrono::steady_clock::now();
+    ReleaseDeviceButtons(engine, table);
+    LOG_WARN_S("Input device disconnected: " << dev.path);
+}
+
+// Reopens a device announced by udev and brings the mappings back in line with its state.
+void HandleDeviceAdded(MappingEngine& engine, InputDevice& dev, int epollFd, const MappingDispatchTable& table) {
+    auto start = std::chrono::steady_clock::now();
+    if (!OpenInputDevice(dev, epollFd, false)) return;
+    ResyncDeviceState(engine, dev.fd, dev.index, table);  // The event mask is reinstalled by the input loop
+    auto end = std::chrono::steady_clock::now();
+    LOG_INFO_S("Input device reconnected: " << dev.path
+               << " (reopen+resync " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us, "
+               << "offline " << std::chrono::duration_cast<std::chrono::milliseconds>(end - dev.disconnectedAt).count() << " ms)");
+}
+
+// Hotplug monitor on the udev netlink socket; only "input" subsystem events are delivered
+struct udev_monitor* CreateHotplugMonitor(struct udev* udev) {
+    if (!udev) return nullptr;
+    struct udev_monitor* monitor = udev_monitor_new_from_netlink(udev, "udev");
+    if (!monitor) return nullptr;
+    if (udev_monitor_filter_add_match_subsystem_devtype(monitor, "input", NULL) < 0 ||
+        udev_monitor_enable_receiving(monitor) < 0) {
+        udev_monitor_unref(monitor);
+        return nullptr;
+    }
+    return monitor;
+}
+
+// --replay: feeds a recording through the same frame pipeline as live devices, either at
+// the recorded timing or as fast as possible. Replayed events are timestamped when
+// applied, so the latency histograms measure the engine alone. run() returns when the
+// recording ends.
+class ReplayInputSource : public InputSource {
+public:
+    ReplayInputSource(const std::string& path, bool asFastAsPossible)
+        : m_path(path), m_asFastAsPossible(asFastAsPossible) {}
+    const char* sourceName() const override { return "replay"; }
+    void run(MappingEngine& engine, const std::atomic<bool>& quit) override;
+
+private:
+    std::string m_path;
+    bool m_asFastAsPossible;
+};
+
+void ReplayInputSource::run(MappingEngine& engine, const std::atomic<bool>& quit) {
+    InputRecordReader reader;
+    if (!reader.open(m_path)) {
+        LOG_ERROR_S("Could not read recording " << m_path);
+        {
+            std::lock_guard<std::mutex> lock(g_consoleMutex);
+            std::cerr << "\nError: " << m_path << " is not a readable JoystickMIDI recording." << std::endl;
+        }
         return;
     }
-    LOG_INFO("Input monitor thread started");
+    LOG_INFO_S("Replaying " << m_path << (m_asFastAsPossible ? " as fast as possible" : " at recorded timing"));
+
+    // Replay starts with the dispatcher so no event is lost to setup
+    while (!quit && !engine.active()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    g_snapshotRequested = false;  // The recording carries its own initial state
+
+    std::vector<std::vector<struct input_event>> frames(g_currentConfig.devices.size());
+    std::vector<bool> dropping(frames.size(), false);
+    std::vector<bool> snapshotFrame(frames.size(), false);
+    for (auto& frame : frames) frame.reserve(512);
+
+    uint64_t records = 0, firstTimestampNs = 0;
+    auto replayStart = std::chrono::steady_clock::now();
+    InputRecord rec;
+    while (!quit && reader.next(rec)) {
+        if (records++ == 0) firstTimestampNs = rec.timestampNs;
+        if (!m_asFastAsPossible && rec.timestampNs > firstTimestampNs) {
+            auto due = replayStart + std::chrono::nanoseconds(rec.timestampNs - firstTimestampNs);
+            // Sleep in slices so a quit request is honoured during long pauses
+            while (!quit && std::chrono::steady_clock::now() < due) {
+                std::this_thread::sleep_until(std::min(due, std::chrono::steady_clock::now() + std::chrono::milliseconds(50)));
+            }
+        }
+
+        auto tables = std::atomic_load(&g_mappingDispatchTables);
+        if (!tables || rec.device >= frames.size() || rec.device >= tables->size()) continue;
+        auto& frame = frames[rec.device];
+        if (rec.type == EV_SYN) {
+            if (rec.code == SYN_DROPPED) {
+                // The resync frame recorded right after the next SYN_REPORT restores the state
+                frame.clear();
+                dropping[rec.device] = true;
+            } else if (rec.code == SYN_REPORT) {
+                if (!dropping[rec.device] && !frame.empty()) {
+                    ApplyInputFrame(engine, (*tables)[rec.device], frame, snapshotFrame[rec.device]);
+                }
+                dropping[rec.device] = false;
+                snapshotFrame[rec.device] = false;
+                frame.clear();
+            }
+            continue;
+        }
+        if (dropping[rec.device]) continue;
+        struct input_event ev = {};  // Zero time: stamped when applied
+        ev.type = rec.type;
+        ev.code = rec.code;
+        ev.value = rec.value;
+        frame.push_back(ev);
+        if (rec.snapshot) snapshotFrame[rec.device] = true;
+    }
+    if (quit && !g_quitFlag) return;  // Stopped for a mapping edit; the restart replays from the start
+
+    double wallMs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - replayStart).count() / 1000.0;
+    double recordedMs = records ? (rec.timestampNs - firstTimestampNs) / 1e6 : 0.0;
+    LOG_INFO_S("Replay finished: " << records << " event(s), recorded span " << recordedMs << " ms, replayed in " << wallMs << " ms");
+    {
+        std::lock_guard<std::mutex> lock(g_consoleMutex);
+        std::cout << "\nReplay finished: " << records << " event(s) in " << std::fixed << std::setprecision(1)
+                  << wallMs << " ms (recorded span " << recordedMs << " ms)" << std::endl;
+    }
+}
 
-    struct input_event ev;
-    struct pollfd pfd;
-    pfd.fd = fd;
-    pfd.events = POLLIN;
+// Live evdev devices: all configured devices on one epoll loop, with udev hotplug
+// reconnect, kernel event masks, SYN_DROPPED resync and optional --record output.
+class EvdevInputSource : public InputSource {
+public:
+    explicit EvdevInputSource(const std::string& recordPath = std::string()) : m_recordPath(recordPath) {}
+    const char* sourceName() const override { return "evdev"; }
+    void run(MappingEngine& engine, const std::atomic<bool>& quit) override;
 
-    while (!g_quitFlag) {
-        int ret = poll(&pfd, 1, 100);
-        if (ret < 0 || !(pfd.revents & POLLIN)) continue;
+private:
+    std::string m_recordPath;
+};
 
-        if (read(fd, &ev, sizeof(ev)) == sizeof(ev)) {
-            // Check all mapped controls for this event
-            for (size_t i = 0; i < g_currentConfig.mappings.size() && i < g_mappingStates.size(); ++i) {
-                const auto& mapping = g_currentConfig.mappings[i];
-                auto& state = g_mappingStates[i];
+void EvdevInputSource::run(MappingEngine& engine, const std::atomic<bool>& quit) {
+    // A recording continues across restarts for mapping edits (UpdateMappings())
+    if (!m_recordPath.empty() && !g_inputRecorder) {
+        g_inputRecorder = std::make_unique<InputRecordWriter>();
+        if (g_inputRecorder->open(m_recordPath)) {
+            LOG_INFO_S("Recording input events to " << m_recordPath);
+        } else {
+            LOG_ERROR_S("Could not open recording file " << m_recordPath << ": " << strerror(errno));
+            std::lock_guard<std::mutex> lock(g_consoleMutex);
+            std::cerr << "\nError: Could not open recording file " << m_recordPath << std::endl;
+            g_inputRecorder.reset();
+        }
+    }
+
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        LOG_ERROR_S("epoll_create1 failed: " << strerror(errno));
+        return;
+    }
+    struct epoll_event wakeEv = {};
+    wakeEv.events = EPOLLIN;
+    wakeEv.data.u64 = INPUT_WAKE_TOKEN;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, g_inputWakeFd, &wakeEv);
+
+    struct udev* udev = udev_new();
+    struct udev_monitor* hotplug = CreateHotplugMonitor(udev);
+    if (hotplug) {
+        struct epoll_event udevEv = {};
+        udevEv.events = EPOLLIN;
+        udevEv.data.u64 = INPUT_UDEV_TOKEN;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, udev_monitor_get_fd(hotplug), &udevEv);
+    } else {
+        LOG_WARN("udev hotplug monitor unavailable, disconnected devices will not be reopened");
+    }
 
-                if (ev.type == mapping.control.eventType && ev.code == mapping.control.eventCode) {
-                    if (static_cast<LONG>(ev.value) != state.currentValue.load()) {
-                        state.currentValue = ev.value;
-                        state.valueChanged = true;
+    // Devices that are missing at startup are picked up by the hotplug monitor later
+    std::vector<InputDevice> devices(g_currentConfig.devices.size());
+    size_t openCount = 0;
+    for (size_t d = 0; d < devices.size(); ++d) {
+        devices[d].index = d;
+        devices[d].path = g_currentConfig.devices[d].path;
+        devices[d].frame.reserve(512);
+        devices[d].disconnectedAt = std::chrono::steady_clock::now();
+        if (OpenInputDevice(devices[d], epollFd)) openCount++;
+    }
+    LOG_INFO_S("Input monitor thread started (" << openCount << " of " << devices.size() << " device(s) open)");
+
+    const int MAX_EPOLL_EVENTS = 16;
+    struct epoll_event ready[MAX_EPOLL_EVENTS];
+
+    while (!quit) {
+        // Re-derive kernel event masks whenever the mappings were edited; edits wake this
+        // thread because masked events would not
+        auto tables = std::atomic_load(&g_mappingDispatchTables);
+        if (!tables) break;
+        for (auto& dev : devices) {
+            if (dev.fd < 0 || !dev.eventMaskSupported || dev.maskedTables == tables || dev.index >= tables->size()) continue;
+            dev.maskedTables = tables;
+            if (!ApplyEventMask(dev.fd, (*tables)[dev.index])) {
+                dev.eventMaskSupported = false;
+                LOG_WARN_S("EVIOCSMASK not supported on " << dev.path << ", receiving all device events: " << strerror(errno));
+            }
+        }
+
+        // Initial state burst once the dispatcher is running
+        if (engine.active() && g_snapshotRequested.exchange(false)) {
+            for (auto& dev : devices) {
+                if (dev.fd >= 0 && dev.index < tables->size()) ResyncDeviceState(engine, dev.fd, dev.index, (*tables)[dev.index], true);
+            }
+            LOG_INFO_S("Sent initial state snapshot for " << engine.states().size() << " mapping(s)");
+        }
+
+        int n = epoll_wait(epollFd, ready, MAX_EPOLL_EVENTS, -1);
+        for (int r = 0; r < n; ++r) {
+            uint64_t token = ready[r].data.u64;
+            if (token == INPUT_WAKE_TOKEN) {
+                uint64_t count;
+                ssize_t ignored = read(g_inputWakeFd, &count, sizeof(count));
+                (void)ignored;
+                continue;
+            }
+            if (token == INPUT_UDEV_TOKEN) {
+                struct udev_device* udevDev = udev_monitor_receive_device(hotplug);
+                if (!udevDev) continue;
+                const char* action = udev_device_get_action(udevDev);
+                const char* devnode = udev_device_get_devnode(udevDev);
+                bool isAdd = action && strcmp(action, "add") == 0;
+                if (isAdd && !IsEventDevnode(devnode)) isAdd = false;
+                DeviceIdentity addedIdentity;
+                if (isAdd) addedIdentity = IdentityFromUdevDevice(udevDev);
+                for (auto& dev : devices) {
+                    if (!action || !devnode || dev.index >= tables->size()) continue;
+                    if (strcmp(action, "remove") == 0 && dev.fd >= 0 && dev.path == devnode) {
+                        HandleDeviceRemoved(engine, dev, epollFd, (*tables)[dev.index]);
+                    } else if (isAdd && dev.fd < 0) {
+                        // Re-enumeration may hand out a different eventN; match on identity
+                        const auto& identity = g_currentConfig.devices[dev.index].identity;
+                        bool sameDevice = identity.empty() ? dev.path == devnode
+                                                           : MatchDeviceIdentity(identity, addedIdentity) >=
+                                                                 RequiredIdentityMatch(identity);
+                        if (!sameDevice) continue;
+                        dev.path = devnode;
+                        HandleDeviceAdded(engine, dev, epollFd, (*tables)[dev.index]);
+                        break;
                     }
                 }
+                udev_device_unref(udevDev);
+                continue;
+            }
+            if (token >= devices.size() || token >= tables->size()) continue;
+            auto& dev = devices[token];
+            if (dev.fd < 0) continue;
+            // A yanked device reports ENODEV/EPOLLHUP before (or instead of) the udev event
+            if ((ready[r].events & (EPOLLHUP | EPOLLERR)) || !ReadInputDevice(engine, dev, (*tables)[token])) {
+                HandleDeviceRemoved(engine, dev, epollFd, (*tables)[token]);
             }
         }
     }
-    close(fd);
+
+    for (auto& dev : devices) CloseInputDevice(dev, epollFd);
+    if (g_inputRecorder && g_quitFlag) {
+        g_inputRecorder->close();
+        LOG_INFO_S("Recorded " << g_inputRecorder->records() << " input event(s) to " << m_recordPath);
+        g_inputRecorder.reset();
+    }
+    if (hotplug) udev_monitor_unref(hotplug);
+    if (udev) udev_unref(udev);
+    close(epollFd);
     LOG_INFO("Input monitor thread stopped");
-    std::cout << "\nInput monitoring thread finished." << std::endl;
+    if (g_quitFlag) std::cout << "\nInput monitoring thread finished." << std::endl;
 }
 
 #endif
@@ -717,6 +1357,232 @@ void ClearInputBuffer() {
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 }
 
+bool InitDispatchSignal() {
+#ifdef _WIN32
+    if (!g_dispatchEvent) g_dispatchEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    return g_dispatchEvent != nullptr;
+#else
+    if (g_dispatchEventFd < 0) g_dispatchEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_inputWakeFd < 0) g_inputWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    return g_dispatchEventFd >= 0 && g_inputWakeFd >= 0;
+#endif
+}
+
+void SignalDispatcher() {
+#ifdef _WIN32
+    if (g_dispatchEvent) SetEvent(g_dispatchEvent);
+#else
+    if (g_dispatchEventFd >= 0) {
+        uint64_t one = 1;
+        // A full counter (EAGAIN) still leaves the fd readable, so the result can be ignored
+        ssize_t ignored = write(g_dispatchEventFd, &one, sizeof(one));
+        (void)ignored;
+    }
+#endif
+}
+
+void WakeInputThread() {
+#ifndef _WIN32
+    if (g_inputWakeFd >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = write(g_inputWakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+#endif
+}
+
+void CloseDispatchSignal() {
+#ifdef _WIN32
+    if (g_dispatchEvent) CloseHandle(g_dispatchEvent);
+    g_dispatchEvent = nullptr;
+#else
+    if (g_dispatchEventFd >= 0) close(g_dispatchEventFd);
+    if (g_inputWakeFd >= 0) close(g_inputWakeFd);
+    g_dispatchEventFd = -1;
+    g_inputWakeFd = -1;
+#endif
+}
+
+std::string DescribeDevices(const MidiMappingConfig& config) {
+    std::string names;
+    for (const auto& dev : config.devices) {
+        if (!names.empty()) names += " + ";
+        names += dev.name;
+    }
+    return names;
+}
+
+// With several controllers, prefix control names with their device number ("D2 Button 3")
+// so identical controls on different devices can be told apart
+void LabelControlsByDevice(std::vector<ControlInfo>& controls, size_t deviceCount) {
+    if (deviceCount < 2) return;
+    for (auto& ctrl : controls) {
+        ctrl.name = "D" + std::to_string(ctrl.deviceIndex + 1) + " " + ctrl.name;
+    }
+}
+
+// --- Real-time Scheduling ---
+
+// Real-time options given on the command line; they override the "realtime" section of
+// the configuration file key by key
+json g_realtimeOverrides = json::object();
+
+RealtimeConfig EffectiveRealtimeConfig() {
+    json merged = g_currentConfig.realtime;
+    merged.update(g_realtimeOverrides);
+    RealtimeConfig realtime = merged.get<RealtimeConfig>();
+    if (realtime.policy != "fifo" && realtime.policy != "rr") {
+        LOG_WARN_S("Unknown real-time policy '" << realtime.policy << "', using fifo");
+        realtime.policy = "fifo";
+    }
+    return realtime;
+}
+
+// A real-time setting that could not be applied is reported on the console and in the
+// log; the application keeps running with normal scheduling
+void ReportRealtimeFailure(const std::string& what, const std::string& reason) {
+    std::cerr << "Warning: " << what << " failed: " << reason << std::endl;
+    LOG_WARN_S(what << " failed: " << reason);
+}
+
+#ifndef _WIN32
+std::string DescribeRealtimeError(int error, const char* privilegeHint) {
+    std::string reason = strerror(error);
+    if (error == EPERM || error == ENOMEM) reason += std::string(" (insufficient privileges: ") + privilegeHint + ")";
+    return reason;
+}
+#endif
+
+// Touches the next 256 KiB of the calling thread's stack, so that deep calls on the
+// real-time path later do not page-fault (the pages stay resident under mlockall)
+void PrefaultStack() {
+    volatile unsigned char buffer[256 * 1024];
+    for (size_t i = 0; i < sizeof(buffer); i += 4096) buffer[i] = 0;
+}
+
+// Locks all current and future pages of the process in memory
+void LockProcessMemory() {
+#ifdef _WIN32
+    ReportRealtimeFailure("Locking memory", "not supported on Windows");
+#else
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        ReportRealtimeFailure("Locking memory (mlockall)",
+                              DescribeRealtimeError(errno, "needs CAP_IPC_LOCK or a higher memlock limit, "
+                                                           "e.g. '@audio - memlock unlimited' in /etc/security/limits.conf"));
+        return;
+    }
+    LOG_INFO("Process memory locked (mlockall)");
+#endif
+}
+
+// Applies the real-time priority and CPU pinning of one thread to the calling thread.
+// role names the thread in messages ("Input", "MIDI").
+void ApplyThreadRealtime(const char* role, const RealtimeConfig& realtime, int priority, int cpu) {
+    const std::string thread = std::string(role) + " thread";
+    bool pinned = false;
+    bool prioritized = false;
+#ifdef _WIN32
+    if (cpu >= 0) {
+        pinned = cpu < 64 && SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu) != 0;
+        if (!pinned) ReportRealtimeFailure("Pinning the " + thread + " to CPU " + std::to_string(cpu),
+                                           "error " + std::to_string(GetLastError()));
+    }
+    if (priority > 0) {
+        // Windows has no priority levels to choose from; any real-time priority maps to
+        // the highest one available to a normal-class process
+        prioritized = SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+        if (!prioritized) ReportRealtimeFailure("Raising the " + thread + " priority",
+                                                "error " + std::to_string(GetLastError()));
+    }
+#else
+    if (cpu >= 0) {
+        int error = EINVAL;
+        if (cpu < CPU_SETSIZE) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
+        pinned = error == 0;
+        if (!pinned) {
+            ReportRealtimeFailure("Pinning the " + thread + " to CPU " + std::to_string(cpu),
+                                  error == EINVAL ? std::string("no such CPU") : std::string(strerror(error)));
+        }
+    }
+    if (priority > 0) {
+        const int policy = realtime.policy == "rr" ? SCHED_RR : SCHED_FIFO;
+        struct sched_param param = {};
+        param.sched_priority = priority;
+        int error = pthread_setschedparam(pthread_self(), policy, &param);
+        prioritized = error == 0;
+        if (!prioritized) {
+            ReportRealtimeFailure("Setting SCHED_" + std::string(policy == SCHED_RR ? "RR" : "FIFO") + " priority " +
+                                      std::to_string(priority) + " for the " + thread,
+                                  DescribeRealtimeError(error, "needs CAP_SYS_NICE or an rtprio limit, "
+                                                               "e.g. '@audio - rtprio 95' in /etc/security/limits.conf"));
+        }
+    }
+#endif
+    if (realtime.lockMemory) PrefaultStack();
+    if (pinned || prioritized) {
+        LOG_INFO_S(thread << ": " << (prioritized ? realtime.policy + " priority " + std::to_string(priority) : "normal priority")
+                   << (pinned ? ", CPU " + std::to_string(cpu) : std::string()));
+    }
+}
+
+// Input thread entry point: runs the selected input source against the engine. A source
+// that ends on its own (a finished replay) stops the application.
+void InputMonitorLoop() {
+    const RealtimeConfig realtime = EffectiveRealtimeConfig();
+    ApplyThreadRealtime("Input", realtime, realtime.inputPriority, realtime.inputCpu);
+
+    std::unique_ptr<InputSource> source;
+#ifdef _WIN32
+    source = std::make_unique<RawInputSource>();
+#else
+    if (!g_replayPath.empty()) source = std::make_unique<ReplayInputSource>(g_replayPath, g_replayAsFastAsPossible);
+    else source = std::make_unique<EvdevInputSource>(g_recordPath);
+#endif
+    LOG_DEBUG_S("Input source: " << source->sourceName());
+    source->run(g_engine, g_inputStopFlag);
+    if (!g_quitFlag && !g_inputStopFlag) {
+        g_quitFlag = true;
+        SignalDispatcher();
+    }
+}
+
+// Starts the input thread. On Windows this waits until the thread's message window
+// exists, so a following JoinInputThread() can always wake it.
+void StartInputThread() {
+#ifdef _WIN32
+    {
+        std::lock_guard<std::mutex> lock(g_inputWindowMutex);
+        g_inputWindowReady = false;
+    }
+    g_inputThread = std::thread(InputMonitorLoop);
+    std::unique_lock<std::mutex> lock(g_inputWindowMutex);
+    g_inputWindowCreated.wait(lock, [] { return g_inputWindowReady; });
+#else
+    g_inputThread = std::thread(InputMonitorLoop);
+#endif
+}
+
+// Stops and joins the input thread without ending the application
+void JoinInputThread() {
+    g_inputStopFlag = true;
+    WakeInputThread();
+#ifdef _WIN32
+    if (g_messageWindow) PostMessage(g_messageWindow, WM_NULL, 0, 0);
+#endif
+    if (g_inputThread.joinable()) g_inputThread.join();
+    g_inputStopFlag = false;
+}
+
+void StopInputThread() {
+    g_quitFlag = true;
+    JoinInputThread();
+}
+
 bool string_ends_with(const std::string& str, const std::string& suffix) {
     return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
 }
@@ -742,91 +1608,116 @@ int GetUserSelection(int maxValidChoice, int minValidChoice) {
     }
 }
 
-// Track the starting cursor position for monitoring output
+// Monitoring display state: rows as last drawn (and, on a legacy Windows console without
+// ANSI support, where the region starts)
+static MonitorRenderer g_monitorRenderer;
 #ifdef _WIN32
 static COORD g_monitoringStartPos = {0, 0};
-static bool g_monitoringPosInitialized = false;
-#else
-static int g_monitoringLineCount = 0;
 #endif
 
-void DisplayMonitoringOutput() {
-    std::lock_guard<std::mutex> lock(g_consoleMutex);
-    const int BAR_WIDTH = 20;
+// Writes text to the terminal with a single system call where possible. Anything still
+// buffered in std::cout goes out first so the order is kept.
+void WriteToTerminal(const std::string& text) {
+    std::cout.flush();
+#ifdef _WIN32
+    DWORD written = 0;
+    WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), text.data(), static_cast<DWORD>(text.size()), &written, NULL);
+#else
+    size_t offset = 0;
+    while (offset < text.size()) {
+        ssize_t n = write(STDOUT_FILENO, text.data() + offset, text.size() - offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        offset += static_cast<size_t>(n);
+    }
+#endif
+}
 
+// Prepares the monitoring region below the current cursor position
+void ResetMonitoringDisplay() {
 #ifdef _WIN32
     HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    bool ansi = GetConsoleMode(hConsole, &mode) &&
+                SetConsoleMode(hConsole, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
     CONSOLE_SCREEN_BUFFER_INFO csbi;
-
-    // Initialize starting position on first call
-    if (!g_monitoringPosInitialized) {
-        GetConsoleScreenBufferInfo(hConsole, &csbi);
-        g_monitoringStartPos = csbi.dwCursorPosition;
-        g_monitoringPosInitialized = true;
-    }
-
-    // Move cursor to starting position
-    SetConsoleCursorPosition(hConsole, g_monitoringStartPos);
+    std::cout.flush();
+    if (GetConsoleScreenBufferInfo(hConsole, &csbi)) g_monitoringStartPos = csbi.dwCursorPosition;
+    g_monitorRenderer.reset(g_currentConfig.mappings.size(), ansi);
 #else
-    // On Linux, move cursor up by the number of mappings we printed last time
-    if (g_monitoringLineCount > 0) {
-        std::cout << "\033[" << g_monitoringLineCount << "A";
-    }
-    g_monitoringLineCount = static_cast<int>(g_currentConfig.mappings.size());
+    g_monitorRenderer.reset(g_currentConfig.mappings.size());
 #endif
+}
 
-    // Display each mapping on its own line (vertical layout)
-    for (size_t i = 0; i < g_currentConfig.mappings.size() && i < g_mappingStates.size(); ++i) {
-        const auto& mapping = g_currentConfig.mappings[i];
-        const auto& state = g_mappingStates[i];
-
-        std::stringstream ss;
-        std::string shortName = mapping.control.name.substr(0, 12);
-        ss << "[" << std::left << std::setw(12) << shortName << "] ";
-
-        if (mapping.control.isButton) {
-            ss << (state.currentValue.load() ? "ON " : "OFF");
-        } else {
-            double percentage = 0.0;
-            LONG displayRangeMin = mapping.control.logicalMin;
-            LONG displayRangeMax = mapping.control.logicalMax;
-
-            if (mapping.calibrationDone) {
-                displayRangeMin = mapping.calibrationMinHid;
-                displayRangeMax = mapping.calibrationMaxHid;
-            }
-
-            LONG displayRange = displayRangeMax - displayRangeMin;
-            if (displayRange > 0) {
-                LONG clampedValue = std::max(displayRangeMin, std::min(displayRangeMax, state.currentValue.load()));
-                percentage = static_cast<double>(clampedValue - displayRangeMin) * 100.0 / static_cast<double>(displayRange);
-            } else if (state.currentValue.load() >= displayRangeMax) {
-                percentage = 100.0;
-            }
+// Redraws the rows that changed since the last call, in one write
+void DisplayMonitoringOutput() {
+    std::lock_guard<std::mutex> lock(g_consoleMutex);
+    if (g_monitorRenderer.render(g_currentConfig, g_engine.states()) == 0) return;
+#ifdef _WIN32
+    if (!g_monitorRenderer.ansi()) SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), g_monitoringStartPos);
+#endif
+    WriteToTerminal(g_monitorRenderer.frame());
+}
 
-            int barLength = static_cast<int>((percentage / 100.0) * BAR_WIDTH + 0.5);
-            barLength = std::max(0, std::min(BAR_WIDTH, barLength));
+// Drops the calling thread below normal priority; failures are harmless and ignored
+void LowerCurrentThreadPriority() {
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#else
+    // The nice value is per thread on Linux
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+#endif
+}
 
-            std::string bar(barLength, '#');
-            std::string empty(BAR_WIDTH - barLength, '-');
+// Marks the display as out of date. Only the clean-to-dirty transition wakes the monitor
+// thread, so this costs one atomic exchange per change and at most one wakeup per frame.
+// The empty critical section orders the flag against a monitor thread about to block.
+void RequestMonitorRefresh() {
+    if (g_monitorDirty.exchange(true, std::memory_order_acq_rel)) return;
+    { std::lock_guard<std::mutex> lock(g_monitorMutex); }
+    g_monitorWake.notify_one();
+}
 
-            ss << "|" << bar << empty << "| " << std::fixed << std::setprecision(0) << std::setw(3) << percentage << "%";
+// Monitor thread: sleeps until a refresh is requested, then draws and sleeps out the rest
+// of the 1/g_monitorHz frame interval, so an idle rig never wakes it and a busy one is
+// drawn at most g_monitorHz times per second. Draws once more on stop so the last state
+// shows.
+void MonitorDisplayLoop() {
+    LowerCurrentThreadPriority();
+    const auto interval = std::chrono::microseconds(1000000 / g_monitorHz);
+    DisplayMonitoringOutput();
+    auto nextFrame = std::chrono::steady_clock::now() + interval;
+    std::unique_lock<std::mutex> lock(g_monitorMutex);
+    while (true) {
+        g_monitorWake.wait(lock, [] { return g_monitorStop || g_monitorDirty.load(std::memory_order_acquire); });
+        g_monitorWake.wait_until(lock, nextFrame, [] { return g_monitorStop; });
+        const bool stopping = g_monitorStop;
+        if (g_monitorDirty.exchange(false, std::memory_order_acq_rel)) {
+            lock.unlock();
+            DisplayMonitoringOutput();
+            nextFrame = std::chrono::steady_clock::now() + interval;
+            lock.lock();
         }
+        if (stopping) break;
+    }
+}
 
-        // Pad with spaces to clear any leftover characters, then newline
-        std::string line = ss.str();
-        line.append(20, ' ');
+void StartMonitorThread() {
+    ResetMonitoringDisplay();
+    g_monitorStop = false;
+    g_monitorDirty = false;
+    g_monitorThread = std::thread(MonitorDisplayLoop);
+}
 
-#ifdef _WIN32
-        // On Windows, use carriage return to overwrite line, then move to next line
-        std::cout << "\r" << line << std::endl;
-#else
-        // On Linux, clear line and print
-        std::cout << "\033[2K" << line << std::endl;
-#endif
+void StopMonitorThread() {
+    {
+        std::lock_guard<std::mutex> lock(g_monitorMutex);
+        g_monitorStop = true;
     }
-
-    std::cout << std::flush;
+    g_monitorWake.notify_one();
+    if (g_monitorThread.joinable()) g_monitorThread.join();
 }
 
 bool SaveConfiguration(const MidiMappingConfig& config, const std::string& filename) {
@@ -885,12 +1776,12 @@ std::vector<fs::path> ListConfigurations(const std::string& directory) {
 }
 
 bool PerformCalibration(size_t mappingIndex) {
-    if (mappingIndex >= g_currentConfig.mappings.size() || mappingIndex >= g_mappingStates.size()) {
+    if (mappingIndex >= g_currentConfig.mappings.size() || mappingIndex >= g_engine.states().size()) {
         return false;
     }
 
     auto& mapping = g_currentConfig.mappings[mappingIndex];
-    auto& state = g_mappingStates[mappingIndex];
+    auto& state = g_engine.states()[mappingIndex];
 
     if (mapping.control.isButton) return true;
 
@@ -952,10 +1843,24 @@ bool PerformCalibration(size_t mappingIndex) {
 //
 // ===================================================================================
 
+// The input thread indexes the mappings, their states and the dispatch tables without
+// locking, so this must only run while it is stopped; use UpdateMappings() once it runs.
 void InitializeMappingStates() {
-    std::lock_guard<std::mutex> lock(g_mappingStatesMutex);
-    g_mappingStates.clear();
-    g_mappingStates.resize(g_currentConfig.mappings.size());
+    g_engine.resetStates();
+#ifndef _WIN32
+    BuildMappingDispatchTables();
+#endif
+}
+
+// Adds or removes mappings with edit() and re-initializes the mapping states. A running
+// input thread is stopped for the change; the input thread is running afterwards either
+// way (calibration needs the live values).
+template <typename Edit>
+void UpdateMappings(Edit edit) {
+    if (g_inputThread.joinable()) JoinInputThread();
+    edit();
+    InitializeMappingStates();
+    StartInputThread();
 }
 
 void ConfigureMappingMidi(ControlMapping& mapping, int defaultChannel) {
@@ -991,8 +1896,84 @@ void ConfigureMappingMidi(ControlMapping& mapping, int defaultChannel) {
     }
 }
 
-int GetEffectiveChannel(const ControlMapping& mapping, int defaultChannel) {
-    return (mapping.midiChannel >= 0) ? mapping.midiChannel : defaultChannel;
+// Locates every configured input device and collects its controls. Returns the devices
+// that could not be found (on Linux these can still be picked up later by hotplug).
+std::vector<const InputDeviceConfig*> LocateConfiguredDevices(std::vector<ControlInfo>& available_controls) {
+    std::vector<const InputDeviceConfig*> missing;
+    available_controls.clear();
+#ifdef _WIN32
+    // On Windows, we need to find the device and get its preparsed data
+    const auto& configured = g_currentConfig.devices[0];
+    LOG_DEBUG_S("Looking for configured device: " << configured.path);
+    auto devices = EnumerateHidDevices();
+    for (auto& dev : devices) {
+        if (dev.path == configured.path) {
+            SetPreparsedData(dev.preparsedData);
+            dev.preparsedData = nullptr; // Prevent destructor from freeing it
+            available_controls = GetAvailableControls(g_preparsedData, dev.caps);
+            LOG_INFO_S("Found configured device: " << configured.name);
+            return missing;
+        }
+    }
+    LOG_WARN_S("Configured device not found: " << configured.name);
+    missing.push_back(&configured);
+#else
+    for (size_t d = 0; d < g_currentConfig.devices.size(); ++d) {
+        auto& dev = g_currentConfig.devices[d];
+        auto controls = ResolveDevicePath(dev) ? GetAvailableControls(dev.path, d) : std::vector<ControlInfo>();
+        if (controls.empty()) {
+            LOG_WARN_S("Configured device not found: " << dev.name);
+            missing.push_back(&dev);
+            continue;
+        }
+        LOG_INFO_S("Found configured device: " << dev.name);
+        available_controls.insert(available_controls.end(), controls.begin(), controls.end());
+    }
+#endif
+    return missing;
+}
+
+bool OpenConfiguredMidiPort() {
+    LOG_DEBUG_S("Looking for configured MIDI port: " << g_currentConfig.midiDeviceName);
+    unsigned int portCount = g_midiOut->getPortCount();
+    for (unsigned int i = 0; i < portCount; ++i) {
+        if (g_midiOut->getPortName(i) == g_currentConfig.midiDeviceName) {
+            if (!g_midiOut->openPort(i)) break;
+            LOG_INFO_S("Opened MIDI port (" << g_midiOut->backendName() << "): " << g_currentConfig.midiDeviceName);
+            return true;
+        }
+    }
+    std::cerr << "Configured MIDI port '" << g_currentConfig.midiDeviceName << "' not found or could not be opened." << std::endl;
+    LOG_ERROR_S("Configured MIDI port not found or could not be opened: " << g_currentConfig.midiDeviceName);
+    return false;
+}
+
+// SIGTERM/SIGINT (console close/Ctrl+C on Windows) request a clean shutdown of the
+// dispatch loop. Only async-signal-safe operations are used: an atomic store and the
+// eventfd write in SignalDispatcher().
+#ifdef _WIN32
+BOOL WINAPI HandleConsoleControl(DWORD) {
+    g_quitFlag = true;
+    SignalDispatcher();
+    return TRUE;
+}
+#else
+void HandleTerminationSignal(int) {
+    g_quitFlag = true;
+    SignalDispatcher();
+}
+#endif
+
+void InstallTerminationHandlers() {
+#ifdef _WIN32
+    SetConsoleCtrlHandler(HandleConsoleControl, TRUE);
+#else
+    struct sigaction sa = {};
+    sa.sa_handler = HandleTerminationSignal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, nullptr);
+    sigaction(SIGINT, &sa, nullptr);
+#endif
 }
 
 bool EditConfiguration(std::vector<ControlInfo>& available_controls) {
@@ -1001,7 +1982,7 @@ bool EditConfiguration(std::vector<ControlInfo>& available_controls) {
     while (!g_quitFlag) {
         ClearScreen();
         std::cout << "--- Edit Configuration ---\n";
-        std::cout << "Device: " << g_currentConfig.hidDeviceName << "\n";
+        std::cout << "Device: " << DescribeDevices(g_currentConfig) << "\n";
         std::cout << "Default MIDI Channel: " << (g_currentConfig.defaultMidiChannel + 1) << "\n";
         std::cout << "Current mappings: " << g_currentConfig.mappings.size() << "\n\n";
 
@@ -1058,7 +2039,8 @@ bool EditConfiguration(std::vector<ControlInfo>& available_controls) {
                             break;
                         }
                         #else
-                        if (m.control.eventType == available_controls[i].eventType &&
+                        if (m.control.deviceIndex == available_controls[i].deviceIndex &&
+                            m.control.eventType == available_controls[i].eventType &&
                             m.control.eventCode == available_controls[i].eventCode) {
                             alreadyMapped = true;
                             break;
@@ -1083,8 +2065,7 @@ bool EditConfiguration(std::vector<ControlInfo>& available_controls) {
                 if (ctrl_choice < (int)available_controls.size()) {
                     ControlMapping newMapping;
                     newMapping.control = available_controls[ctrl_choice];
-                    g_currentConfig.mappings.push_back(newMapping);
-                    InitializeMappingStates();
+                    UpdateMappings([&] { g_currentConfig.mappings.push_back(newMapping); });
 
                     size_t mappingIdx = g_currentConfig.mappings.size() - 1;
                     ConfigureMappingMidi(g_currentConfig.mappings[mappingIdx], g_currentConfig.defaultMidiChannel);
@@ -1126,8 +2107,7 @@ bool EditConfiguration(std::vector<ControlInfo>& available_controls) {
                 if (removeChoice < (int)g_currentConfig.mappings.size()) {
                     std::cout << "Remove '" << g_currentConfig.mappings[removeChoice].control.name << "'? [0] No  [1] Yes\n";
                     if (GetUserSelection(1, 0) == 1) {
-                        g_currentConfig.mappings.erase(g_currentConfig.mappings.begin() + removeChoice);
-                        InitializeMappingStates();
+                        UpdateMappings([&] { g_currentConfig.mappings.erase(g_currentConfig.mappings.begin() + removeChoice); });
                         configModified = true;
                         std::cout << "Mapping removed.\n";
                     }
@@ -1237,6 +2217,425 @@ bool EditConfiguration(std::vector<ControlInfo>& available_controls) {
     return configModified;
 }
 
+// ===================================================================================
+//
+// MIDI DISPATCH
+//
+// ===================================================================================
+
+std::string DescribeInputStats() {
+    const auto& stats = g_engine.stats();
+    std::ostringstream out;
+    out << "Input events: " << stats.buttonEvents.load() << " button, " << stats.axisEvents.load() << " axis ("
+        << stats.axisCoalesced.load() << " coalesced), " << stats.ringOverflows.load() << " ring overflow(s), "
+        << stats.frames.load() << " frame(s), " << stats.synDropped.load() << " SYN_DROPPED";
+    return out.str();
+}
+
+// Latency percentiles of mapping i ("name: n=... p50=..." in microseconds), or an empty
+// string if it has not sent anything
+std::string DescribeLatency(size_t i) {
+    const auto& hist = g_engine.states()[i].latency;
+    if (!hist || hist->count() == 0) return std::string();
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(1)
+         << g_currentConfig.mappings[i].control.name << ": n=" << hist->count()
+         << " p50=" << hist->percentile(0.5) / 1e3 << " p99=" << hist->percentile(0.99) / 1e3
+         << " p99.9=" << hist->percentile(0.999) / 1e3 << " max=" << hist->max() / 1e3;
+    return line.str();
+}
+
+// Prints (and logs) the input-to-MIDI-send latency percentiles of every mapping that sent
+// at least one message.
+void PrintLatencySummary() {
+    bool headerPrinted = false;
+    for (size_t i = 0; i < g_currentConfig.mappings.size() && i < g_engine.states().size(); ++i) {
+        std::string line = DescribeLatency(i);
+        if (line.empty()) continue;
+        if (!headerPrinted) {
+            std::cout << "Latency, input to MIDI send (us):" << std::endl;
+            headerPrinted = true;
+        }
+        std::cout << "  " << line << std::endl;
+        LOG_INFO_S("Latency " << line << " us");
+    }
+}
+
+// ===================================================================================
+//
+// CONTROL CHANNEL
+//
+// ===================================================================================
+
+// Stats dump: bank, event counters, MIDI drops and per-mapping latency
+std::string FormatStatsReport() {
+    std::ostringstream out;
+    out << "Bank " << g_engine.bank() << ", " << DescribeInputStats() << "\n";
+    for (size_t i = 0; i < g_currentConfig.mappings.size() && i < g_engine.states().size(); ++i) {
+        std::string line = DescribeLatency(i);
+        if (!line.empty()) out << "  " << line << " us\n";
+    }
+    return out.str();
+}
+
+// Prints command feedback in the monitoring terminal. The display region is redrawn in
+// full below the text afterwards, since the text moved it.
+void ShowControlOutput(const std::string& text) {
+    std::lock_guard<std::mutex> lock(g_consoleMutex);
+    WriteToTerminal(text);
+    if (g_monitorThread.joinable()) {
+        ResetMonitoringDisplay();
+        RequestMonitorRefresh();
+    }
+}
+
+// Carries out a command from either source and returns the reply text. Quit and stats are
+// handled right here; panic and bank changes are posted to the dispatcher.
+std::string ExecuteControlCommand(ControlCommand command, int bank) {
+    switch (command) {
+        case ControlCommand::Quit:
+            LOG_INFO("Quit requested through the control channel");
+            g_quitFlag = true;
+            SignalDispatcher();
+            return "Quitting\n";
+        case ControlCommand::Panic:
+            g_controlMailbox.postPanic();
+            SignalDispatcher();
+            return "Panic: all notes off\n";
+        case ControlCommand::Bank:
+        case ControlCommand::BankNext:
+        case ControlCommand::BankPrevious: {
+            if (command == ControlCommand::BankNext) bank = g_controlMailbox.postBankStep(1);
+            else if (command == ControlCommand::BankPrevious) bank = g_controlMailbox.postBankStep(-1);
+            else bank = g_controlMailbox.postBank(bank);
+            SignalDispatcher();
+            return "Bank " + std::to_string(bank) + " (MIDI channels +" + std::to_string(bank) + ")\n";
+        }
+        case ControlCommand::Stats: {
+            std::string report = FormatStatsReport();
+            LOG_INFO_S("Stats: " << report.substr(0, report.size() - 1));
+            return report;
+        }
+        case ControlCommand::Help:
+            return std::string(HOTKEY_HELP) + "\nSocket commands: quit, panic, bank N|+|-, stats, help\n";
+        case ControlCommand::None:
+            break;
+    }
+    return "Unknown command (try help)\n";
+}
+
+// Runs the commands posted by the control thread; called by the dispatcher only when the
+// mailbox is not empty
+void ApplyControlCommands() {
+    const uint32_t commands = g_controlMailbox.take();
+    if (commands & ControlMailbox::PANIC) g_engine.panic();
+    if (commands & ControlMailbox::BANK) g_engine.setBank(g_controlMailbox.requestedBank());
+}
+
+#ifdef _WIN32
+
+// Hotkeys from the console input buffer; stops when g_controlStopEvent is set or the
+// console input is not available
+void ControlLoop(bool hotkeys) {
+    if (!hotkeys) return;
+    HANDLE hInput = GetStdHandle(STD_INPUT_HANDLE);
+    HANDLE handles[2] = {g_controlStopEvent, hInput};
+    while (!g_quitFlag) {
+        if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0 + 1) break;
+        INPUT_RECORD record;
+        DWORD count = 0;
+        if (!ReadConsoleInputA(hInput, &record, 1, &count)) break;
+        if (count == 0 || record.EventType != KEY_EVENT || !record.Event.KeyEvent.bKeyDown) continue;
+        int bank = 0;
+        ControlCommand command = HotkeyCommand(record.Event.KeyEvent.uChar.AsciiChar, bank);
+        if (command == ControlCommand::None) continue;
+        std::string reply = ExecuteControlCommand(command, bank);
+        if (command != ControlCommand::Quit) ShowControlOutput(reply);
+    }
+}
+
+void StartControlThread(bool hotkeys) {
+    if (!hotkeys) return;
+    g_controlStopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!g_controlStopEvent) return;
+    g_controlThread = std::thread(ControlLoop, hotkeys);
+}
+
+void StopControlThread() {
+    if (g_controlStopEvent) SetEvent(g_controlStopEvent);
+    if (g_controlThread.joinable()) g_controlThread.join();
+    if (g_controlStopEvent) CloseHandle(g_controlStopEvent);
+    g_controlStopEvent = nullptr;
+}
+
+#else // Linux
+
+static struct termios g_savedTermios;
+static bool g_termiosSaved = false;
+
+// Single keys without Enter and without echo; Ctrl+C still raises SIGINT
+void EnableHotkeyTerminal() {
+    if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &g_savedTermios) != 0) return;
+    struct termios raw = g_savedTermios;
+    raw.c_lflag &= ~static_cast<tcflag_t>(ICANON | ECHO);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    g_termiosSaved = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+}
+
+void RestoreTerminal() {
+    if (g_termiosSaved) tcsetattr(STDIN_FILENO, TCSANOW, &g_savedTermios);
+    g_termiosSaved = false;
+}
+
+// Creates the --control-socket listening socket (owner-only permissions). A stale socket
+// file left by a previous run is replaced.
+bool OpenControlSocket() {
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (g_controlSocketPath.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Control socket path is too long: " << g_controlSocketPath << std::endl;
+        return false;
+    }
+    memcpy(addr.sun_path, g_controlSocketPath.c_str(), g_controlSocketPath.size() + 1);
+
+    struct stat st;
+    if (lstat(g_controlSocketPath.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) unlink(g_controlSocketPath.c_str());
+
+    g_controlListenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (g_controlListenFd < 0 ||
+        bind(g_controlListenFd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        chmod(g_controlSocketPath.c_str(), 0600) != 0 || listen(g_controlListenFd, 4) != 0) {
+        std::cerr << "Cannot create control socket " << g_controlSocketPath << ": " << strerror(errno) << std::endl;
+        LOG_ERROR_S("Cannot create control socket " << g_controlSocketPath << ": " << strerror(errno));
+        if (g_controlListenFd >= 0) close(g_controlListenFd);
+        g_controlListenFd = -1;
+        return false;
+    }
+    LOG_INFO_S("Control socket: " << g_controlSocketPath);
+    return true;
+}
+
+void CloseControlSocket() {
+    if (g_controlListenFd < 0) return;
+    close(g_controlListenFd);
+    g_controlListenFd = -1;
+    unlink(g_controlSocketPath.c_str());
+}
+
+// Control thread: single-key commands from the terminal (stdin closing quits, as Enter
+// did before) and line commands from socket clients, each answered on its connection
+void ControlLoop(bool hotkeys) {
+    const size_t MAX_CLIENTS = 8;
+    const size_t MAX_LINE = 256;
+    struct ControlClient {
+        int fd;
+        std::string pending;
+    };
+    std::vector<ControlClient> clients;
+    std::vector<struct pollfd> pfds;
+
+    while (!g_quitFlag) {
+        pfds.clear();
+        pfds.push_back({g_controlWakeFd, POLLIN, 0});
+        pfds.push_back({hotkeys ? STDIN_FILENO : -1, POLLIN, 0});
+        pfds.push_back({g_controlListenFd, POLLIN, 0});
+        for (const auto& client : clients) pfds.push_back({client.fd, POLLIN, 0});
+        if (poll(pfds.data(), pfds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (pfds[0].revents) break;
+
+        if (pfds[1].revents) {
+            char keys[32];
+            ssize_t n = read(STDIN_FILENO, keys, sizeof(keys));
+            if (n <= 0) {
+                if (n < 0 && errno == EINTR) continue;
+                ExecuteControlCommand(ControlCommand::Quit, 0);
+                break;
+            }
+            for (ssize_t k = 0; k < n; ++k) {
+                int bank = 0;
+                ControlCommand command = HotkeyCommand(keys[k], bank);
+                if (command == ControlCommand::None) continue;
+                std::string reply = ExecuteControlCommand(command, bank);
+                if (command != ControlCommand::Quit) ShowControlOutput(reply);
+            }
+        }
+
+        // Client fds start at pfds[3], in the same order as clients
+        for (size_t c = clients.size(); c-- > 0;) {
+            if (!pfds[3 + c].revents) continue;
+            ControlClient& client = clients[c];
+            char buffer[256];
+            ssize_t n = recv(client.fd, buffer, sizeof(buffer), 0);
+            bool closeClient = n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR);
+            if (n > 0) client.pending.append(buffer, static_cast<size_t>(n));
+            size_t newline;
+            while ((newline = client.pending.find('\n')) != std::string::npos) {
+                int bank = 0;
+                ControlCommand command = ParseControlCommand(client.pending.substr(0, newline), bank);
+                client.pending.erase(0, newline + 1);
+                std::string reply = ExecuteControlCommand(command, bank);
+                ssize_t ignored = send(client.fd, reply.data(), reply.size(), MSG_NOSIGNAL);
+                (void)ignored;
+            }
+            if (client.pending.size() > MAX_LINE) closeClient = true;
+            if (closeClient) {
+                close(client.fd);
+                clients.erase(clients.begin() + static_cast<std::ptrdiff_t>(c));
+            }
+        }
+
+        if (pfds[2].revents & POLLIN) {
+            int fd = accept4(g_controlListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd >= 0 && clients.size() < MAX_CLIENTS) clients.push_back({fd, std::string()});
+            else if (fd >= 0) close(fd);
+        }
+    }
+    for (const auto& client : clients) close(client.fd);
+}
+
+void StartControlThread(bool hotkeys) {
+    if (!hotkeys && g_controlListenFd < 0) return;
+    g_controlWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_controlWakeFd < 0) return;
+    if (hotkeys) EnableHotkeyTerminal();
+    g_controlThread = std::thread(ControlLoop, hotkeys);
+}
+
+void StopControlThread() {
+    if (g_controlWakeFd >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = write(g_controlWakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+    if (g_controlThread.joinable()) g_controlThread.join();
+    if (g_controlWakeFd >= 0) close(g_controlWakeFd);
+    g_controlWakeFd = -1;
+    RestoreTerminal();
+    CloseControlSocket();
+}
+
+#endif
+
+// Runs the MIDI dispatch loop until quit is requested, then shuts everything down.
+// Returns the process exit code.
+int RunMonitoring(bool interactive) {
+    InstallTerminationHandlers();
+
+    // Event-driven dispatch: sleep until the input thread or the control thread signals,
+    // so an idle rig does not wake up at all. The display and the hotkeys/control socket
+    // have their own threads; dispatch only flags display changes and checks the control
+    // mailbox with one atomic load. Headless runs have no display and ignore stdin; they
+    // stop on SIGTERM/SIGINT or a quit command on the control socket.
+    const bool monitor = interactive && g_monitorEnabled;
+    const RealtimeConfig realtime = EffectiveRealtimeConfig();
+    if (realtime.lockMemory) LockProcessMemory();
+    if (monitor) StartMonitorThread();
+    StartControlThread(interactive);
+    // This thread dispatches MIDI; its real-time settings are applied after the helper
+    // threads above were created so that they do not inherit them
+    ApplyThreadRealtime("MIDI", realtime, realtime.midiPriority, realtime.midiCpu);
+    g_engine.setActive(true);
+    // Ask the input thread for the current position of every control so the receiver
+    // converges immediately instead of waiting for each control to move
+    g_snapshotRequested = true;
+    WakeInputThread();
+    while (!g_quitFlag) {
+        #ifdef _WIN32
+        WaitForSingleObject(g_dispatchEvent, INFINITE);
+        #else
+        struct pollfd pfd;
+        pfd.fd = g_dispatchEventFd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, -1) > 0 && (pfd.revents & POLLIN)) {
+            uint64_t count;
+            ssize_t ignored = read(g_dispatchEventFd, &count, sizeof(count));
+            (void)ignored;
+        }
+        #endif
+
+        if (g_engine.dispatch() && monitor) RequestMonitorRefresh();
+        if (g_controlMailbox.pending()) ApplyControlCommands();
+    }
+    // A source that ended on its own (a finished replay) may have committed its last frame
+    // while the loop above was already past dispatch(); deliver it before stopping
+    if (g_engine.dispatch() && monitor) RequestMonitorRefresh();
+
+    g_engine.setActive(false);
+    StopControlThread();
+    if (monitor) {
+        StopMonitorThread();
+        std::cout << "\n\n";
+    }
+    std::cout << "Exiting..." << std::endl;
+    const std::string inputStats = DescribeInputStats();
+    std::cout << inputStats << std::endl;
+    LOG_INFO(inputStats);
+    PrintLatencySummary();
+    LOG_INFO("Application shutting down");
+    StopInputThread();
+    if (g_midiOut->isPortOpen()) g_midiOut->closePort();
+    CloseDispatchSignal();
+    Logger::instance().shutdown();
+    return 0;
+}
+
+// ===================================================================================
+//
+// HEADLESS MODE
+//
+// ===================================================================================
+
+// Runs a saved configuration without any prompts (for systemd units and boot scripts).
+// Missing input devices are waited for via hotplug on Linux; a missing MIDI port is fatal.
+int RunHeadless(const std::string& configFile, std::chrono::steady_clock::time_point startTime) {
+    LOG_INFO_S("Headless mode: " << configFile);
+    if (!LoadConfiguration(configFile, g_currentConfig)) {
+        std::cerr << "Failed to load configuration: " << configFile << std::endl;
+        return 1;
+    }
+    if (g_currentConfig.devices.empty() || g_currentConfig.mappings.empty()) {
+        std::cerr << "Configuration has no input device or no mappings: " << configFile << std::endl;
+        LOG_ERROR("Configuration has no input device or no mappings");
+        return 1;
+    }
+    InstallTerminationHandlers();
+
+    std::vector<ControlInfo> available_controls;
+    auto missing = LocateConfiguredDevices(available_controls);
+#ifdef _WIN32
+    for (const auto* dev : missing) {
+        std::cerr << "Input device not connected: " << dev->name << " (" << dev->path << ")" << std::endl;
+    }
+    if (!missing.empty()) return 1;  // No hotplug support on Windows
+#else
+    // A replay does not need the devices at all
+    for (const auto* dev : missing) {
+        if (!g_replayPath.empty()) break;
+        std::cerr << "Input device not connected, waiting for it: " << dev->name << " (" << dev->path << ")" << std::endl;
+    }
+#endif
+
+    InitializeMappingStates();
+    StartInputThread();
+    if (!OpenConfiguredMidiPort()) {
+        StopInputThread();
+        return 1;
+    }
+
+    auto readyMs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - startTime).count() / 1000.0;
+    std::cout << "JoystickMIDI running: " << DescribeDevices(g_currentConfig) << " -> "
+              << g_currentConfig.midiDeviceName << " (" << g_currentConfig.mappings.size()
+              << " mapping(s), MIDI ready after " << std::fixed << std::setprecision(1) << readyMs << " ms)" << std::endl;
+    LOG_INFO_S("Startup to MIDI-ready: " << readyMs << " ms");
+
+    return RunMonitoring(false);
+}
+
 // ===================================================================================
 //
 // MAIN APPLICATION
@@ -1244,33 +2643,184 @@ bool EditConfiguration(std::vector<ControlInfo>& available_controls) {
 // ===================================================================================
 
 int main(int argc, char* argv[]) {
-    // Parse command-line arguments for logging
+    auto startTime = std::chrono::steady_clock::now();
+    std::string configFile;
+    std::string midiBackend = "rtmidi";
+    bool runHeadless = false;
+    std::string logLevel;
+    LogOptions logOptions;
+
+    // Parse command-line arguments
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
         if ((arg == "-d" || arg == "--debug") && i + 1 < argc) {
-            Logger::instance().init(argv[i + 1]);
-            i++; // Skip the level argument
+            logLevel = argv[++i];
+        } else if (arg == "--log-dir" && i + 1 < argc) {
+            logOptions.directory = argv[++i];
+        } else if (arg == "--log-max-size" && i + 1 < argc) {
+            logOptions.maxFileBytes = std::strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+        } else if (arg == "--log-rotate-minutes" && i + 1 < argc) {
+            logOptions.maxFileAge = std::chrono::minutes(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--log-keep" && i + 1 < argc) {
+            logOptions.maxFiles = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--log-max-total" && i + 1 < argc) {
+            logOptions.maxTotalBytes = std::strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+        } else if (arg == "--rt-policy" && i + 1 < argc) {
+            std::string policy = argv[++i];
+            if (policy != "fifo" && policy != "rr") {
+                std::cerr << "--rt-policy must be fifo or rr" << std::endl;
+                return 1;
+            }
+            g_realtimeOverrides["policy"] = policy;
+        } else if ((arg == "--input-priority" || arg == "--midi-priority") && i + 1 < argc) {
+            int priority = std::atoi(argv[++i]);
+            if (priority < 0 || priority > 99) {
+                std::cerr << arg << " must be between 0 and 99" << std::endl;
+                return 1;
+            }
+            g_realtimeOverrides[arg == "--input-priority" ? "inputPriority" : "midiPriority"] = priority;
+        } else if ((arg == "--input-cpu" || arg == "--midi-cpu") && i + 1 < argc) {
+            int cpu = std::atoi(argv[++i]);
+            if (cpu < -1) {
+                std::cerr << arg << " must be a CPU number (or -1 for any)" << std::endl;
+                return 1;
+            }
+            g_realtimeOverrides[arg == "--input-cpu" ? "inputCpu" : "midiCpu"] = cpu;
+        } else if (arg == "--mlock") {
+            g_realtimeOverrides["lockMemory"] = true;
+        } else if (arg == "--no-monitor") {
+            g_monitorEnabled = false;
+        } else if (arg == "--monitor-hz" && i + 1 < argc) {
+            g_monitorHz = std::atoi(argv[++i]);
+            if (g_monitorHz < 1 || g_monitorHz > 1000) {
+                std::cerr << "--monitor-hz must be between 1 and 1000" << std::endl;
+                return 1;
+            }
+        } else if ((arg == "-c" || arg == "--config") && i + 1 < argc) {
+            configFile = argv[++i];
+        } else if (arg == "-r" || arg == "--run") {
+            runHeadless = true;
+        } else if ((arg == "-m" || arg == "--midi-backend") && i + 1 < argc) {
+            midiBackend = argv[++i];
+#ifndef _WIN32
+        } else if (arg == "--record" && i + 1 < argc) {
+            g_recordPath = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            g_replayPath = argv[++i];
+        } else if (arg == "--replay-fast") {
+            g_replayAsFastAsPossible = true;
+        } else if (arg == "--control-socket" && i + 1 < argc) {
+            g_controlSocketPath = argv[++i];
+#endif
         } else if (arg == "-h" || arg == "--help") {
             std::cout << "Usage: JoystickMIDI [options]\n"
                       << "Options:\n"
                       << "  -d, --debug LEVEL  Enable logging at LEVEL (DEBUG, INFO, WARN, ERROR)\n"
                       << "                     Logs at specified level and above to file\n"
+                      << "  --log-dir DIR      Directory for log files (default: current directory)\n"
+                      << "  --log-max-size MB  Start a new log file at this size (default 8, 0 = no limit)\n"
+                      << "  --log-rotate-minutes N\n"
+                      << "                     Also start a new log file every N minutes (default 0 = off)\n"
+                      << "  --log-keep N       Keep at most N log files, deleting the oldest (default 0 =\n"
+                      << "                     no limit)\n"
+                      << "  --log-max-total MB Keep at most MB of log files in total (default 0 = no limit)\n"
+                      << "  -c, --config FILE  Load FILE instead of choosing a configuration\n"
+                      << "  -r, --run          Run the --config file headless: no prompts, no display,\n"
+                      << "                     stop with SIGTERM/SIGINT\n"
+                      << "  --input-priority N, --midi-priority N\n"
+                      << "                     Run the input / MIDI dispatch thread real-time at priority\n"
+                      << "                     N (1-99, 0 = normal scheduling)\n"
+                      << "  --rt-policy fifo|rr\n"
+                      << "                     Real-time policy: SCHED_FIFO (default) or SCHED_RR\n"
+                      << "  --input-cpu N, --midi-cpu N\n"
+                      << "                     Pin the input / MIDI dispatch thread to CPU N\n"
+                      << "  --mlock            Lock memory (mlockall) and prefault the thread stacks\n"
+                      << "  --no-monitor       Do not draw the live monitoring display\n"
+                      << "  --monitor-hz N     Refresh the monitoring display at most N times per second\n"
+                      << "                     (default 60)\n"
+                      << "  -m, --midi-backend NAME\n"
+                      << "                     MIDI output backend: rtmidi (default)"
+#ifdef JOYSTICKMIDI_ALSA_SEQ
+                      << " or alsa (native ALSA\n"
+                      << "                     sequencer, batched direct delivery)"
+#endif
+                      << "\n"
+#ifndef _WIN32
+                      << "  --record FILE      Write every raw input event to FILE (binary)\n"
+                      << "  --replay FILE      Use a recording instead of the input devices; exits when\n"
+                      << "                     the recording ends (requires --config)\n"
+                      << "  --replay-fast      Replay as fast as possible instead of at recorded timing\n"
+                      << "  --control-socket PATH\n"
+                      << "                     Accept commands (quit, panic, bank N|+|-, stats, help), one\n"
+                      << "                     per line, on a Unix socket at PATH\n"
+#endif
                       << "  -h, --help         Show this help message\n"
                       << "\nExamples:\n"
                       << "  JoystickMIDI -d DEBUG    Log everything (DEBUG and above)\n"
                       << "  JoystickMIDI -d INFO     Log INFO, WARN, and ERROR\n"
-                      << "  JoystickMIDI -d ERROR    Log only ERROR messages\n";
+                      << "  JoystickMIDI -d ERROR    Log only ERROR messages\n"
+                      << "  JoystickMIDI --config rig.hidmidi.json --run\n";
             return 0;
+        } else {
+            std::cerr << "Unknown option: " << arg << " (see --help)" << std::endl;
+            return 1;
         }
     }
+    if (runHeadless && configFile.empty()) {
+        std::cerr << "--run requires --config FILE" << std::endl;
+        return 1;
+    }
+#ifndef _WIN32
+    if (!g_replayPath.empty() && configFile.empty()) {
+        std::cerr << "--replay requires --config FILE" << std::endl;
+        return 1;
+    }
+    if (!g_replayPath.empty() && !g_recordPath.empty()) {
+        std::cerr << "--record and --replay cannot be combined" << std::endl;
+        return 1;
+    }
+#endif
 
+    if (!logLevel.empty()) Logger::instance().init(logLevel, logOptions);
     LOG_INFO("Application started");
+#ifndef _WIN32
+    if (!g_controlSocketPath.empty() && !OpenControlSocket()) return 1;
+#endif
+
+    g_midiOut = CreateMidiSink(midiBackend);
+    if (!g_midiOut) {
+        std::cerr << "MIDI backend '" << midiBackend << "' is unknown or could not be opened." << std::endl;
+        LOG_ERROR_S("MIDI backend not available: " << midiBackend);
+        return 1;
+    }
+    LOG_INFO_S("MIDI backend: " << g_midiOut->backendName());
+    g_engine.attach(&g_currentConfig, g_midiOut.get(), SignalDispatcher);
+
+    if (!InitDispatchSignal()) {
+        std::cerr << "Failed to create dispatcher wakeup signal." << std::endl;
+        LOG_ERROR("Failed to create dispatcher wakeup signal");
+        return 1;
+    }
+
+    if (runHeadless) {
+        return RunHeadless(configFile, startTime);
+    }
 
     ClearScreen();
     std::cout << "--- HID to MIDI Mapper (Multi-Control) ---\n\n";
     bool configLoaded = false;
 
-    auto configFiles = ListConfigurations(".");
+    if (!configFile.empty()) {
+        LOG_INFO_S("Loading configuration: " << configFile);
+        if (!LoadConfiguration(configFile, g_currentConfig)) {
+            std::cerr << "Failed to load configuration: " << configFile << std::endl;
+            return 1;
+        }
+        std::cout << "Configuration loaded successfully with " << g_currentConfig.mappings.size() << " mapping(s)." << std::endl;
+        configLoaded = true;
+    }
+
+    auto configFiles = configLoaded ? std::vector<fs::path>() : ListConfigurations(".");
     LOG_DEBUG_S("Found " << configFiles.size() << " configuration file(s)");
     if (!configFiles.empty()) {
         std::cout << "Found existing configurations:\n";
@@ -1320,15 +2870,14 @@ int main(int argc, char* argv[]) {
         int dev_choice = GetUserSelection(available_devices.size() - 1, 0);
         if (g_quitFlag) return 1;
 
-        g_currentConfig.hidDeviceName = available_devices[dev_choice].name;
-        g_currentConfig.hidDevicePath = available_devices[dev_choice].path;
-        LOG_INFO_S("Selected device: " << g_currentConfig.hidDeviceName);
+        g_currentConfig.devices = {InputDeviceConfig{available_devices[dev_choice].path, available_devices[dev_choice].name, {}}};
+        LOG_INFO_S("Selected device: " << g_currentConfig.devices[0].name);
 
         // On Windows, we need the preparsed data from the selected device
         UINT dataSize = 0;
         GetRawInputDeviceInfo(available_devices[dev_choice].handle, RIDI_PREPARSEDDATA, NULL, &dataSize);
         if (dataSize > 0) {
-            g_preparsedData = (PHIDP_PREPARSED_DATA)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, dataSize);
+            SetPreparsedData((PHIDP_PREPARSED_DATA)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, dataSize));
             GetRawInputDeviceInfo(available_devices[dev_choice].handle, RIDI_PREPARSEDDATA, g_preparsedData, &dataSize);
         }
         available_controls = GetAvailableControls(g_preparsedData, available_devices[dev_choice].caps);
@@ -1347,13 +2896,33 @@ int main(int argc, char* argv[]) {
             std::cout << "[" << i << "] " << available_devices[i].name << " (" << available_devices[i].path << ")" << std::endl;
             LOG_DEBUG_S("  Device " << i << ": " << available_devices[i].name);
         }
-        int dev_choice = GetUserSelection(available_devices.size() - 1, 0);
-        if (g_quitFlag) return 1;
+        // Several controllers (e.g. stick + throttle + pedals) can be combined in one configuration
+        while (!g_quitFlag) {
+            int dev_choice = GetUserSelection(available_devices.size() - 1, 0);
+            if (g_quitFlag) return 1;
+
+            bool alreadySelected = false;
+            for (const auto& dev : g_currentConfig.devices) {
+                if (dev.path == available_devices[dev_choice].path) alreadySelected = true;
+            }
+            if (alreadySelected) {
+                std::cout << "Controller already selected.\n";
+            } else {
+                size_t deviceIndex = g_currentConfig.devices.size();
+                g_currentConfig.devices.push_back(InputDeviceConfig{available_devices[dev_choice].path,
+                                                                    available_devices[dev_choice].name,
+                                                                    available_devices[dev_choice].identity});
+                LOG_INFO_S("Selected device " << deviceIndex << ": " << available_devices[dev_choice].name);
+                auto controls = GetAvailableControls(available_devices[dev_choice].path, deviceIndex);
+                available_controls.insert(available_controls.end(), controls.begin(), controls.end());
+            }
 
-        g_currentConfig.hidDeviceName = available_devices[dev_choice].name;
-        g_currentConfig.hidDevicePath = available_devices[dev_choice].path;
-        LOG_INFO_S("Selected device: " << g_currentConfig.hidDeviceName);
-        available_controls = GetAvailableControls(g_currentConfig.hidDevicePath);
+            std::cout << "\nAdd another controller? [0] No  [1] Yes\n";
+            if (GetUserSelection(1, 0) != 1) break;
+            std::cout << "Select controller:\n";
+        }
+        if (g_quitFlag) return 1;
+        LabelControlsByDevice(available_controls, g_currentConfig.devices.size());
         #endif
 
         LOG_DEBUG_S("Found " << available_controls.size() << " available control(s)");
@@ -1366,7 +2935,7 @@ int main(int argc, char* argv[]) {
         ClearScreen();
         std::cout << "--- Step 2: Select MIDI Output ---\n";
         LOG_DEBUG("Enumerating MIDI output ports");
-        unsigned int portCount = g_midiOut.getPortCount();
+        unsigned int portCount = g_midiOut->getPortCount();
         LOG_DEBUG_S("Found " << portCount << " MIDI output port(s)");
         if (portCount == 0) {
             std::cerr << "No MIDI output ports available." << std::endl;
@@ -1374,12 +2943,16 @@ int main(int argc, char* argv[]) {
             return 1;
         }
         for (unsigned int i = 0; i < portCount; ++i) {
-            std::cout << "  [" << i << "]: " << g_midiOut.getPortName(i) << std::endl;
-            LOG_DEBUG_S("  MIDI port " << i << ": " << g_midiOut.getPortName(i));
+            std::cout << "  [" << i << "]: " << g_midiOut->getPortName(i) << std::endl;
+            LOG_DEBUG_S("  MIDI port " << i << ": " << g_midiOut->getPortName(i));
         }
         int midi_choice = GetUserSelection(portCount - 1, 0);
-        g_midiOut.openPort(midi_choice);
-        g_currentConfig.midiDeviceName = g_midiOut.getPortName(midi_choice);
+        g_currentConfig.midiDeviceName = g_midiOut->getPortName(midi_choice);
+        if (!g_midiOut->openPort(midi_choice)) {
+            std::cerr << "Failed to open MIDI port: " << g_currentConfig.midiDeviceName << std::endl;
+            LOG_ERROR_S("Failed to open MIDI port: " << g_currentConfig.midiDeviceName);
+            return 1;
+        }
         LOG_INFO_S("Selected MIDI port: " << g_currentConfig.midiDeviceName);
 
         ClearScreen();
@@ -1407,7 +2980,8 @@ int main(int argc, char* argv[]) {
                         break;
                     }
                     #else
-                    if (m.control.eventType == available_controls[i].eventType &&
+                    if (m.control.deviceIndex == available_controls[i].deviceIndex &&
+                        m.control.eventType == available_controls[i].eventType &&
                         m.control.eventCode == available_controls[i].eventCode) {
                         alreadyMapped = true;
                         break;
@@ -1437,14 +3011,7 @@ int main(int argc, char* argv[]) {
                 LOG_INFO_S("Adding mapping for control: " << newMapping.control.name);
 
                 // Initialize mapping states so calibration can work
-                g_currentConfig.mappings.push_back(newMapping);
-                InitializeMappingStates();
-
-                // Start input thread if not already running (needed for calibration)
-                if (!g_inputThread.joinable()) {
-                    g_inputThread = std::thread(InputMonitorLoop);
-                    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // Let thread start
-                }
+                UpdateMappings([&] { g_currentConfig.mappings.push_back(newMapping); });
 
                 size_t mappingIdx = g_currentConfig.mappings.size() - 1;
                 ConfigureMappingMidi(g_currentConfig.mappings[mappingIdx], g_currentConfig.defaultMidiChannel);
@@ -1463,73 +3030,51 @@ int main(int argc, char* argv[]) {
         if (g_currentConfig.mappings.empty()) {
             std::cerr << "No controls mapped. Exiting." << std::endl;
             LOG_WARN("No controls mapped, exiting");
-            g_quitFlag = true;
-            if (g_inputThread.joinable()) g_inputThread.join();
+            StopInputThread();
             return 1;
         }
         LOG_INFO_S("Configuration complete with " << g_currentConfig.mappings.size() << " mapping(s)");
     } else { // Config was loaded
-        LOG_DEBUG_S("Looking for configured device: " << g_currentConfig.hidDevicePath);
-        #ifdef _WIN32
-            // On Windows, we need to find the device and get its preparsed data
-            bool found = false;
-            while (!found && !g_quitFlag) {
-                auto devices = EnumerateHidDevices();
-                for(auto& dev : devices) {
-                    if (dev.path == g_currentConfig.hidDevicePath) {
-                        g_preparsedData = dev.preparsedData;
-                        dev.preparsedData = nullptr; // Prevent destructor from freeing it
-                        available_controls = GetAvailableControls(g_preparsedData, dev.caps);
-                        found = true;
-                        LOG_INFO_S("Found configured device: " << g_currentConfig.hidDeviceName);
-                        break;
-                    }
-                }
-                if (!found) {
-                    LOG_WARN_S("Configured device not found: " << g_currentConfig.hidDeviceName);
-                    ClearScreen();
-                    std::cout << "--- Device Not Connected ---\n\n";
-                    std::cout << "The configured device was not found:\n";
-                    std::cout << "  " << g_currentConfig.hidDeviceName << "\n\n";
-                    std::cout << "Please connect the device and try again.\n\n";
-                    std::cout << "[0] Retry\n[1] Exit\n";
-                    int retryChoice = GetUserSelection(1, 0);
-                    if (g_quitFlag || retryChoice == 1) {
-                        LOG_INFO("User chose to exit after device not found");
-                        return 1;
-                    }
-                    LOG_DEBUG("User retrying device connection");
-                }
+        if (g_currentConfig.devices.empty()) {
+            std::cerr << "Configuration does not list any input device." << std::endl;
+            LOG_ERROR("Configuration does not list any input device");
+            return 1;
+        }
+        while (!g_quitFlag) {
+            auto missing = LocateConfiguredDevices(available_controls);
+            if (missing.empty()) break;
+            #ifndef _WIN32
+            if (!g_replayPath.empty()) break;  // A replay does not need the devices
+            #endif
+
+            ClearScreen();
+            std::cout << "--- Device Not Connected ---\n\n";
+            std::cout << "The configured device was not found:\n";
+            for (const auto* dev : missing) {
+                std::cout << "  " << dev->name << "\n";
+                std::cout << "  (" << dev->path << ")\n";
             }
-        #else
-            // On Linux, check if device exists and get available controls
-            bool found = false;
-            while (!found && !g_quitFlag) {
-                if (fs::exists(g_currentConfig.hidDevicePath)) {
-                    available_controls = GetAvailableControls(g_currentConfig.hidDevicePath);
-                    if (!available_controls.empty()) {
-                        found = true;
-                        LOG_INFO_S("Found configured device: " << g_currentConfig.hidDeviceName);
-                    }
-                }
-                if (!found) {
-                    LOG_WARN_S("Configured device not found: " << g_currentConfig.hidDeviceName);
-                    ClearScreen();
-                    std::cout << "--- Device Not Connected ---\n\n";
-                    std::cout << "The configured device was not found:\n";
-                    std::cout << "  " << g_currentConfig.hidDeviceName << "\n";
-                    std::cout << "  (" << g_currentConfig.hidDevicePath << ")\n\n";
-                    std::cout << "Please connect the device and try again.\n\n";
-                    std::cout << "[0] Retry\n[1] Exit\n";
-                    int retryChoice = GetUserSelection(1, 0);
-                    if (g_quitFlag || retryChoice == 1) {
-                        LOG_INFO("User chose to exit after device not found");
-                        return 1;
-                    }
-                    LOG_DEBUG("User retrying device connection");
-                }
+            std::cout << "\n";
+            std::cout << "Please connect the device and try again.\n\n";
+            #ifdef _WIN32
+            std::cout << "[0] Retry\n[1] Exit\n";
+            int retryChoice = GetUserSelection(1, 0);
+            #else
+            std::cout << "[0] Retry\n[1] Exit\n[2] Continue and connect the device later\n";
+            int retryChoice = GetUserSelection(2, 0);
+            #endif
+            if (g_quitFlag || retryChoice == 1) {
+                LOG_INFO("User chose to exit after device not found");
+                return 1;
             }
-        #endif
+            if (retryChoice == 2) {
+                // The input thread's hotplug monitor opens the device once it appears
+                LOG_INFO("Continuing without all devices, waiting for hotplug");
+                break;
+            }
+            LOG_DEBUG("User retrying device connection");
+        }
+        LabelControlsByDevice(available_controls, g_currentConfig.devices.size());
 
         // Ask if user wants to edit the configuration
         std::cout << "\nOptions:\n[0] Run with current configuration\n[1] Edit configuration\n";
@@ -1539,7 +3084,7 @@ int main(int argc, char* argv[]) {
         // Initialize mapping states and start input thread
         InitializeMappingStates();
         LOG_DEBUG("Starting input monitor thread");
-        g_inputThread = std::thread(InputMonitorLoop);
+        StartInputThread();
         std::this_thread::sleep_for(std::chrono::milliseconds(100)); // Let thread start
 
         if (editChoice == 1) {
@@ -1548,8 +3093,7 @@ int main(int argc, char* argv[]) {
 
             if (g_currentConfig.mappings.empty()) {
                 std::cerr << "No controls mapped. Exiting." << std::endl;
-                g_quitFlag = true;
-                if (g_inputThread.joinable()) g_inputThread.join();
+                StopInputThread();
                 return 1;
             }
 
@@ -1572,24 +3116,10 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        LOG_DEBUG_S("Looking for configured MIDI port: " << g_currentConfig.midiDeviceName);
-        unsigned int portCount = g_midiOut.getPortCount();
-        int midi_port = -1;
-        for (unsigned int i = 0; i < portCount; ++i) {
-            if (g_midiOut.getPortName(i) == g_currentConfig.midiDeviceName) {
-                midi_port = i;
-                break;
-            }
-        }
-        if (midi_port == -1) {
-            std::cerr << "Configured MIDI port '" << g_currentConfig.midiDeviceName << "' not found." << std::endl;
-            LOG_ERROR_S("Configured MIDI port not found: " << g_currentConfig.midiDeviceName);
-            g_quitFlag = true;
-            if (g_inputThread.joinable()) g_inputThread.join();
+        if (!OpenConfiguredMidiPort()) {
+            StopInputThread();
             return 1;
         }
-        g_midiOut.openPort(midi_port);
-        LOG_INFO_S("Opened MIDI port: " << g_currentConfig.midiDeviceName);
     }
 
     if (!configLoaded) {
@@ -1611,10 +3141,10 @@ int main(int argc, char* argv[]) {
 
     ClearScreen();
     std::cout << "--- Monitoring Active ---\n";
-    std::cout << "Device: " << g_currentConfig.hidDeviceName << std::endl;
+    std::cout << "Device: " << DescribeDevices(g_currentConfig) << std::endl;
     std::cout << "Mappings: " << g_currentConfig.mappings.size() << std::endl;
     LOG_INFO("Starting monitoring mode");
-    LOG_INFO_S("Device: " << g_currentConfig.hidDeviceName);
+    LOG_INFO_S("Device: " << DescribeDevices(g_currentConfig));
     LOG_INFO_S("MIDI Port: " << g_currentConfig.midiDeviceName);
     LOG_INFO_S("Mappings: " << g_currentConfig.mappings.size());
     for (size_t i = 0; i < g_currentConfig.mappings.size(); ++i) {
@@ -1625,96 +3155,8 @@ int main(int argc, char* argv[]) {
                   << " " << m.midiNoteOrCCNumber << std::endl;
     }
     std::cout << "MIDI Port: " << g_currentConfig.midiDeviceName << std::endl;
-    std::cout << "(Press Enter to exit on Linux, or close window)\n\n";
-
-    // Reset monitoring display position tracking
-#ifdef _WIN32
-    g_monitoringPosInitialized = false;
-#else
-    g_monitoringLineCount = 0;
-#endif
-
-    auto lastDisplayTime = std::chrono::steady_clock::now();
-    while (!g_quitFlag) {
-        auto now = std::chrono::steady_clock::now();
-        if (now - lastDisplayTime > std::chrono::milliseconds(1000 / 60)) {
-            DisplayMonitoringOutput();
-            lastDisplayTime = now;
-        }
-
-        // Process all mappings
-        for (size_t i = 0; i < g_currentConfig.mappings.size() && i < g_mappingStates.size(); ++i) {
-            auto& mapping = g_currentConfig.mappings[i];
-            auto& state = g_mappingStates[i];
-
-            if (state.valueChanged.exchange(false)) {
-                std::vector<unsigned char> message;
-                int channel = GetEffectiveChannel(mapping, g_currentConfig.defaultMidiChannel);
-
-                if (mapping.control.isButton) {
-                    bool pressed = state.currentValue.load() != 0;
-                    if (pressed != (state.previousValue != 0)) {
-                        if (mapping.midiMessageType == MidiMessageType::NOTE_ON_OFF) {
-                            message = {(unsigned char)((pressed ? 0x90 : 0x80) | channel),
-                                       (unsigned char)mapping.midiNoteOrCCNumber,
-                                       (unsigned char)(pressed ? mapping.midiValueNoteOnVelocity : 0)};
-                            LOG_DEBUG_S(mapping.control.name << ": Note " << (pressed ? "On" : "Off")
-                                       << " Ch" << (channel+1) << " Note" << mapping.midiNoteOrCCNumber
-                                       << " Vel" << (pressed ? mapping.midiValueNoteOnVelocity : 0));
-                        } else {
-                            message = {(unsigned char)(0xB0 | channel),
-                                       (unsigned char)mapping.midiNoteOrCCNumber,
-                                       (unsigned char)(pressed ? mapping.midiValueCCOn : mapping.midiValueCCOff)};
-                            LOG_DEBUG_S(mapping.control.name << ": CC Ch" << (channel+1)
-                                       << " CC" << mapping.midiNoteOrCCNumber
-                                       << " Val" << (pressed ? mapping.midiValueCCOn : mapping.midiValueCCOff));
-                        }
-                        if (!message.empty()) g_midiOut.sendMessage(&message);
-                    }
-                } else { // Axis
-                    if (mapping.calibrationDone) {
-                        LONG range = mapping.calibrationMaxHid - mapping.calibrationMinHid;
-                        if (range > 0) {
-                            LONG clamped = std::max(mapping.calibrationMinHid,
-                                                    std::min(mapping.calibrationMaxHid, state.currentValue.load()));
-                            double norm = (double)(clamped - mapping.calibrationMinHid) / range;
-                            if (mapping.reverseAxis) norm = 1.0 - norm;
-                            int midiVal = (int)(norm * 127.0 + 0.5);
-                            if (midiVal != state.lastSentMidiValue) {
-                                message = {(unsigned char)(0xB0 | channel),
-                                           (unsigned char)mapping.midiNoteOrCCNumber,
-                                           (unsigned char)midiVal};
-                                g_midiOut.sendMessage(&message);
-                                LOG_DEBUG_S(mapping.control.name << ": CC Ch" << (channel+1)
-                                           << " CC" << mapping.midiNoteOrCCNumber << " Val" << midiVal);
-                                state.lastSentMidiValue = midiVal;
-                            }
-                        }
-                    }
-                }
-                state.previousValue = state.currentValue.load();
-            }
-        }
-
-        #ifndef _WIN32
-        {
-            std::lock_guard<std::mutex> lock(g_consoleMutex);
-            struct timeval tv = {0L, 0L};
-            fd_set fds;
-            FD_ZERO(&fds);
-            FD_SET(0, &fds);
-            if (select(1, &fds, NULL, NULL, &tv) > 0) {
-                g_quitFlag = true;
-            }
-        }
-        #endif
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-    }
+    if (!g_monitorEnabled) std::cout << "Monitoring display disabled (--no-monitor)\n";
+    std::cout << HOTKEY_HELP << "\n\n";
 
-    std::cout << "\n\nExiting..." << std::endl;
-    LOG_INFO("Application shutting down");
-    if (g_inputThread.joinable()) g_inputThread.join();
-    if (g_midiOut.isPortOpen()) g_midiOut.closePort();
-    Logger::instance().shutdown();
-    return 0;
+    return RunMonitoring(true);
 }
@@ -0,0 +1,12 @@
+#pragma once
+// ===================================================================================
+// AllocationCounter.h - Heap allocation counting for benchmarks and tests
+// ===================================================================================
+//
+// Link tests/AllocationCounter.cpp into a test or benchmark executable to replace the
+// global operator new with a counting one. Never link it into JoystickMIDI itself.
+
+#include <cstdint>
+
+// Number of global operator new calls made by the process so far
+uint64_t AllocationCount();
@@ -0,0 +1,142 @@
+// ===================================================================================
+// alloc_check.cpp - Hot-path allocation check (JoystickMIDI_alloc_check, ctest "alloc_check")
+// ===================================================================================
+//
+// Replays a recording through MappingEngine the way the evdev input thread applies it
+// (publish() per event, commitFrame() per SYN_REPORT) and dispatches every committed frame
+// inline. Any heap allocation between the first event and the last dispatch() fails the
+// check. ctest runs it on the 1 kHz axis sweep written by
+//
+//   JoystickMIDI_loadgen --axes 1 --buttons 0 --rate 1000 --duration 5
+//                        --write-recording sweep.jmrec --write-config sweep.hidmidi.json
+//
+// Each backend that has an output port is checked with its real encoding path (RtMidi and,
+// when built, the native ALSA sequencer); MemoryMidiSink is always checked so an engine
+// regression is caught even without a port. The configuration's MIDI port is used when it
+// exists, otherwise the first one.
+//
+// Exit status: 0 = no allocations, 1 = allocations or an error, 77 = no MIDI backend had
+// an output port and only MemoryMidiSink was checked (ctest reports the test as skipped).
+
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <linux/input.h>
+
+#include "InputRecorder.h"
+#include "MappingConfig.h"
+#include "MappingEngine.h"
+#include "MidiSink.h"
+#include "tests/AllocationCounter.h"
+
+static const int SKIP_EXIT_CODE = 77;
+
+struct ReplayResult {
+    uint64_t events = 0;
+    uint64_t dispatchedFrames = 0;  // Frames that produced MIDI
+    uint64_t allocations = 0;
+};
+
+// Only the counted loop runs between the two AllocationCount() reads; the recording, the
+// engine states and the sink are all set up beforehand
+static bool Replay(const MidiMappingConfig& config, const std::string& recordingPath, MidiSink& sink, ReplayResult& result) {
+    InputRecordReader reader;
+    if (!reader.open(recordingPath)) {
+        std::cerr << "Could not read recording " << recordingPath << std::endl;
+        return false;
+    }
+    MappingEngine engine;
+    engine.attach(&config, &sink);
+    engine.resetStates();
+    engine.setActive(true);
+
+    const uint64_t allocsBefore = AllocationCount();
+    InputRecord rec;
+    bool anyChanged = false;
+    while (reader.next(rec)) {
+        result.events++;
+        if (rec.type == EV_SYN) {
+            if (rec.code != SYN_REPORT) continue;
+            engine.commitFrame(anyChanged);
+            anyChanged = false;
+            if (engine.dispatch()) result.dispatchedFrames++;
+            continue;
+        }
+        for (size_t i = 0; i < config.mappings.size(); ++i) {
+            const auto& control = config.mappings[i].control;
+            if (control.eventType == rec.type && control.eventCode == rec.code &&
+                engine.publish(i, static_cast<LONG>(rec.value), rec.snapshot)) {
+                anyChanged = true;
+            }
+        }
+    }
+    result.allocations = AllocationCount() - allocsBefore;
+    engine.setActive(false);
+    return true;
+}
+
+// Opens the configured port, or the first one if it does not exist
+static bool OpenPort(MidiSink& sink, const std::string& name) {
+    const unsigned int count = sink.getPortCount();
+    for (unsigned int i = 0; i < count; ++i) {
+        if (sink.getPortName(i) == name) return sink.openPort(i);
+    }
+    return count > 0 && sink.openPort(0);
+}
+
+// Returns false if the check failed
+static bool Check(const MidiMappingConfig& config, const std::string& recordingPath, MidiSink& sink) {
+    ReplayResult result;
+    if (!Replay(config, recordingPath, sink, result)) return false;
+    const bool ok = result.allocations == 0 && result.dispatchedFrames > 0;
+    std::cout << sink.backendName() << ": " << result.events << " event(s), " << result.dispatchedFrames
+              << " frame(s) sent, " << result.allocations << " heap allocation(s) - " << (ok ? "OK" : "FAILED") << std::endl;
+    if (result.dispatchedFrames == 0) std::cerr << "No MIDI was produced; does the configuration match the recording?" << std::endl;
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " CONFIG RECORDING" << std::endl;
+        return 1;
+    }
+    MidiMappingConfig config;
+    try {
+        std::ifstream file(argv[1]);
+        config = json::parse(file).get<MidiMappingConfig>();
+    } catch (const std::exception& e) {
+        std::cerr << "Could not load configuration " << argv[1] << ": " << e.what() << std::endl;
+        return 1;
+    }
+    const std::string recordingPath = argv[2];
+
+    bool ok = true;
+    MemoryMidiSink memory;
+    memory.openPort(0);
+    ok = Check(config, recordingPath, memory) && ok;
+
+    bool backendChecked = false;
+    for (const char* backend : {"rtmidi", "alsa"}) {
+        std::unique_ptr<MidiSink> sink;
+        try {
+            sink = CreateMidiSink(backend);
+        } catch (const std::exception& e) {
+            std::cout << backend << ": not available (" << e.what() << ")" << std::endl;
+            continue;
+        }
+        if (!sink) continue;  // Not built
+        if (!OpenPort(*sink, config.midiDeviceName)) {
+            std::cout << backend << ": no MIDI output port, skipped" << std::endl;
+            continue;
+        }
+        ok = Check(config, recordingPath, *sink) && ok;
+        sink->closePort();
+        backendChecked = true;
+    }
+    if (!ok) return 1;
+    return backendChecked ? 0 : SKIP_EXIT_CODE;
+}
@@ -0,0 +1,409 @@
+// ===================================================================================
+// uinput_joystick.cpp - Virtual joystick load generator (JoystickMIDI_loadgen, Linux)
+// ===================================================================================
+//
+// Creates a joystick with a configurable number of axes and buttons through /dev/uinput
+// and drives it at a fixed report rate, so JoystickMIDI's real device path (udev
+// enumeration, control discovery, the evdev input thread) can be stress-tested without
+// the hardware. Each report changes the selected axes and toggles buttons round-robin,
+// followed by one SYN_REPORT. Reports that miss their deadline are counted; compare the
+// totals with JoystickMIDI's event, coalescing and SYN_DROPPED statistics.
+//
+// Example (64-axis, 128-button cockpit at 1 kHz for 30 s):
+//   JoystickMIDI_loadgen --axes 64 --buttons 128 --rate 1000 --duration 30
+//                        --write-config loadgen.hidmidi.json --midi-port "Midi Through:Midi Through Port-0 14:0"
+//   JoystickMIDI --config loadgen.hidmidi.json --run
+//
+// With --write-recording FILE no device is created: the same reports are written, with
+// their nominal timestamps, as a JoystickMIDI recording for --replay (e.g. the 1 kHz axis
+// sweep replayed by the alloc_check test).
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "InputRecorder.h"
+#include "MappingConfig.h"
+
+// evdev has ABS_CNT (64) absolute axis codes. ABS_MT_SLOT is swallowed by the kernel, and
+// the remaining ABS_MT_* codes make udev classify the device as a touch device instead of
+// a joystick, so only codes below ABS_MT_SLOT are used unless --allow-mt-axes is given.
+static const int SAFE_AXIS_COUNT = ABS_MT_SLOT;
+static const int MAX_AXIS_COUNT = ABS_CNT - 1;  // Everything except ABS_MT_SLOT
+// Buttons are numbered from BTN_JOYSTICK, as JoystickMIDI lists them
+static const int MAX_BUTTON_COUNT = KEY_CNT - BTN_JOYSTICK;
+
+enum class Pattern { SWEEP, SINE, RANDOM, HOLD };
+
+struct LoadOptions {
+    int axes = 8;
+    int buttons = 16;
+    int rateHz = 1000;
+    double durationSec = 10.0;     // 0 = until interrupted
+    double settleSec = 2.0;        // Wait after creation so udev and JoystickMIDI pick the device up
+    int axesPerReport = -1;        // -1 = all axes change in every report
+    int buttonsPerReport = 1;
+    double periodMs = 1000.0;      // Axis motion period (sweep / sine)
+    Pattern pattern = Pattern::SWEEP;
+    int32_t axisMin = -32768;
+    int32_t axisMax = 32767;
+    bool allowMtAxes = false;
+    std::string name = "JoystickMIDI Load Generator";
+    std::string configPath;        // --write-config
+    std::string midiPort;          // MIDI port name written into the generated config
+    std::string recordingPath;     // --write-recording: write a recording instead of driving a device
+};
+
+static std::atomic<bool> g_quit{false};
+
+static void HandleSignal(int) { g_quit = true; }
+
+static uint64_t MonotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static void SleepUntilNs(uint64_t deadlineNs) {
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(deadlineNs / 1000000000ull);
+    ts.tv_nsec = static_cast<long>(deadlineNs % 1000000000ull);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR && !g_quit) {}
+}
+
+// Axis code for the i-th axis: ABS_X upwards, skipping ABS_MT_SLOT
+static int AxisCode(int i) { return i < ABS_MT_SLOT ? i : i + 1; }
+
+static bool ParsePattern(const std::string& s, Pattern& pattern) {
+    if (s == "sweep") pattern = Pattern::SWEEP;
+    else if (s == "sine") pattern = Pattern::SINE;
+    else if (s == "random") pattern = Pattern::RANDOM;
+    else if (s == "hold") pattern = Pattern::HOLD;
+    else return false;
+    return true;
+}
+
+// Creates the uinput device; returns the fd or -1
+static int CreateDevice(const LoadOptions& options) {
+    int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+    if (fd < 0) {
+        std::cerr << "Cannot open /dev/uinput: " << strerror(errno)
+                  << " (load the uinput module and check permissions)" << std::endl;
+        return -1;
+    }
+
+    bool ok = ioctl(fd, UI_SET_EVBIT, EV_SYN) >= 0;
+    if (options.buttons > 0) {
+        ok = ok && ioctl(fd, UI_SET_EVBIT, EV_KEY) >= 0;
+        for (int i = 0; ok && i < options.buttons; ++i) ok = ioctl(fd, UI_SET_KEYBIT, BTN_JOYSTICK + i) >= 0;
+    }
+    if (options.axes > 0) {
+        ok = ok && ioctl(fd, UI_SET_EVBIT, EV_ABS) >= 0;
+        for (int i = 0; ok && i < options.axes; ++i) {
+            struct uinput_abs_setup abs;
+            memset(&abs, 0, sizeof(abs));
+            abs.code = static_cast<__u16>(AxisCode(i));
+            abs.absinfo.minimum = options.axisMin;
+            abs.absinfo.maximum = options.axisMax;
+            abs.absinfo.value = options.axisMin + (options.axisMax - options.axisMin) / 2;
+            ok = ioctl(fd, UI_SET_ABSBIT, abs.code) >= 0 && ioctl(fd, UI_ABS_SETUP, &abs) >= 0;
+        }
+    }
+
+    struct uinput_setup setup;
+    memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_VIRTUAL;
+    setup.id.vendor = 0x1209;   // pid.codes test range
+    setup.id.product = 0x0001;
+    setup.id.version = 1;
+    strncpy(setup.name, options.name.c_str(), UINPUT_MAX_NAME_SIZE - 1);
+    ok = ok && ioctl(fd, UI_DEV_SETUP, &setup) >= 0 && ioctl(fd, UI_DEV_CREATE) >= 0;
+
+    if (!ok) {
+        std::cerr << "Failed to create uinput device: " << strerror(errno) << std::endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// /dev/input/eventN of the created device, or empty if it cannot be determined
+static std::string DeviceNode(int fd) {
+    char sysname[64] = {0};
+    if (ioctl(fd, UI_GET_SYSNAME(sizeof(sysname)), sysname) < 0) return std::string();
+    const std::string sysDir = std::string("/sys/devices/virtual/input/") + sysname;
+    for (int i = 0; i < 1024; ++i) {
+        std::ifstream probe(sysDir + "/event" + std::to_string(i) + "/dev");
+        if (probe) return "/dev/input/event" + std::to_string(i);
+    }
+    return std::string();
+}
+
+// Configuration mapping every axis to a CC and every button to a note, 128 per channel
+static bool WriteConfig(const LoadOptions& options, const std::string& devicePath) {
+    MidiMappingConfig config;
+    config.devices.push_back(InputDeviceConfig{devicePath, options.name, DeviceIdentity{}});
+    config.midiDeviceName = options.midiPort;
+    int slot = 0;
+    auto addMapping = [&](bool isButton, int code, const std::string& name) {
+        ControlMapping mapping;
+        mapping.control.isButton = isButton;
+        mapping.control.eventType = isButton ? EV_KEY : EV_ABS;
+        mapping.control.eventCode = static_cast<uint16_t>(code);
+        mapping.control.logicalMin = isButton ? 0 : options.axisMin;
+        mapping.control.logicalMax = isButton ? 1 : options.axisMax;
+        mapping.control.name = name;
+        mapping.midiMessageType = isButton ? MidiMessageType::NOTE_ON_OFF : MidiMessageType::CC;
+        mapping.midiChannel = (slot / 128) % 16;
+        mapping.midiNoteOrCCNumber = slot % 128;
+        if (!isButton) {
+            mapping.calibrationMinHid = options.axisMin;
+            mapping.calibrationMaxHid = options.axisMax;
+            mapping.calibrationDone = true;
+        }
+        config.mappings.push_back(mapping);
+        slot++;
+    };
+    for (int i = 0; i < options.axes; ++i) addMapping(false, AxisCode(i), "Axis " + std::to_string(AxisCode(i)));
+    for (int i = 0; i < options.buttons; ++i) addMapping(true, BTN_JOYSTICK + i, "Button " + std::to_string(i));
+
+    std::ofstream ofs(options.configPath);
+    if (!ofs) return false;
+    ofs << json(config).dump(4);
+    return static_cast<bool>(ofs);
+}
+
+static void PrintUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --axes N              Absolute axes (default 8, max " << SAFE_AXIS_COUNT
+              << ", " << MAX_AXIS_COUNT << " with --allow-mt-axes)\n"
+              << "  --buttons N           Buttons from BTN_JOYSTICK (default 16, max " << MAX_BUTTON_COUNT << ")\n"
+              << "  --rate HZ             Reports per second (default 1000)\n"
+              << "  --duration SEC        Run time, 0 = until Ctrl+C (default 10)\n"
+              << "  --settle SEC          Wait after creating the device before sending (default 2)\n"
+              << "  --axes-per-report N   Axes changed per report (default: all)\n"
+              << "  --buttons-per-report N Buttons toggled per report (default 1)\n"
+              << "  --pattern P           Axis motion: sweep, sine, random, hold (default sweep)\n"
+              << "  --period MS           Sweep/sine period in milliseconds (default 1000)\n"
+              << "  --range MIN:MAX       Axis range (default -32768:32767)\n"
+              << "  --allow-mt-axes       Also use ABS_MT_* codes (udev may no longer see a joystick)\n"
+              << "  --name NAME           Device name\n"
+              << "  --write-config FILE   Write a JoystickMIDI configuration mapping every control\n"
+              << "  --midi-port NAME      MIDI port name for the written configuration\n"
+              << "  --write-recording FILE Write the reports to a JoystickMIDI recording (for --replay)\n"
+              << "                        instead of creating a device; needs a non-zero --duration\n"
+              << "  -h, --help            Show this help\n";
+}
+
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--axes" && hasValue) options.axes = std::atoi(argv[++i]);
+        else if (arg == "--buttons" && hasValue) options.buttons = std::atoi(argv[++i]);
+        else if (arg == "--rate" && hasValue) options.rateHz = std::atoi(argv[++i]);
+        else if (arg == "--duration" && hasValue) options.durationSec = std::atof(argv[++i]);
+        else if (arg == "--settle" && hasValue) options.settleSec = std::atof(argv[++i]);
+        else if (arg == "--axes-per-report" && hasValue) options.axesPerReport = std::atoi(argv[++i]);
+        else if (arg == "--buttons-per-report" && hasValue) options.buttonsPerReport = std::atoi(argv[++i]);
+        else if (arg == "--period" && hasValue) options.periodMs = std::atof(argv[++i]);
+        else if (arg == "--allow-mt-axes") options.allowMtAxes = true;
+        else if (arg == "--name" && hasValue) options.name = argv[++i];
+        else if (arg == "--write-config" && hasValue) options.configPath = argv[++i];
+        else if (arg == "--midi-port" && hasValue) options.midiPort = argv[++i];
+        else if (arg == "--write-recording" && hasValue) options.recordingPath = argv[++i];
+        else if (arg == "--pattern" && hasValue) {
+            if (!ParsePattern(argv[++i], options.pattern)) {
+                std::cerr << "Unknown pattern: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--range" && hasValue) {
+            std::string range = argv[++i];
+            size_t colon = range.find(':', 1);
+            if (colon == std::string::npos) {
+                std::cerr << "Invalid range: " << range << std::endl;
+                return 1;
+            }
+            options.axisMin = std::atoi(range.substr(0, colon).c_str());
+            options.axisMax = std::atoi(range.substr(colon + 1).c_str());
+        } else if (arg == "-h" || arg == "--help") {
+            PrintUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    const int axisLimit = options.allowMtAxes ? MAX_AXIS_COUNT : SAFE_AXIS_COUNT;
+    if (options.axes > axisLimit) {
+        std::cerr << "Warning: evdev has " << ABS_CNT << " absolute axis codes; " << axisLimit
+                  << " are usable" << (options.allowMtAxes ? "" : " without --allow-mt-axes")
+                  << ". Creating " << axisLimit << " axes instead of " << options.axes << "." << std::endl;
+        options.axes = axisLimit;
+    }
+    options.axes = std::max(0, options.axes);
+    options.buttons = std::max(0, std::min(options.buttons, MAX_BUTTON_COUNT));
+    if (options.axes == 0 && options.buttons == 0) {
+        std::cerr << "Nothing to generate: no axes and no buttons" << std::endl;
+        return 1;
+    }
+    if (options.rateHz <= 0 || options.axisMax <= options.axisMin) {
+        std::cerr << "Invalid rate or axis range" << std::endl;
+        return 1;
+    }
+    if (options.axesPerReport < 0 || options.axesPerReport > options.axes) options.axesPerReport = options.axes;
+    options.buttonsPerReport = std::max(0, std::min(options.buttonsPerReport, options.buttons));
+
+    // Recording mode: reports are generated on a simulated clock, without a device or sleeping
+    const bool recording = !options.recordingPath.empty();
+    InputRecordWriter recorder;
+    int fd = -1;
+    std::string devicePath;
+    if (recording) {
+        if (options.durationSec <= 0) {
+            std::cerr << "--write-recording needs a non-zero --duration" << std::endl;
+            return 1;
+        }
+        if (!recorder.open(options.recordingPath)) {
+            std::cerr << "Could not write " << options.recordingPath << std::endl;
+            return 1;
+        }
+        devicePath = "/dev/input/event0";  // Replay does not open the device
+        options.settleSec = 0;
+        std::cout << "Recording " << options.axes << " axes, " << options.buttons << " buttons, "
+                  << options.rateHz << " Hz to " << options.recordingPath << std::endl;
+    } else {
+        fd = CreateDevice(options);
+        if (fd < 0) return 1;
+        devicePath = DeviceNode(fd);
+        std::cout << "Created \"" << options.name << "\" at " << (devicePath.empty() ? "(unknown node)" : devicePath)
+                  << ": " << options.axes << " axes, " << options.buttons << " buttons, "
+                  << options.rateHz << " Hz" << std::endl;
+    }
+
+    signal(SIGINT, HandleSignal);
+    signal(SIGTERM, HandleSignal);
+
+    if (!options.configPath.empty()) {
+        if (WriteConfig(options, devicePath)) {
+            std::cout << "Configuration written to " << options.configPath << std::endl;
+        } else {
+            std::cerr << "Could not write " << options.configPath << std::endl;
+        }
+    }
+
+    if (!recording) SleepUntilNs(MonotonicNs() + static_cast<uint64_t>(options.settleSec * 1e9));
+
+    // One report = the changed axes, the toggled buttons and SYN_REPORT in a single write()
+    std::vector<struct input_event> report;
+    report.reserve(static_cast<size_t>(options.axesPerReport + options.buttonsPerReport + 1));
+    std::vector<uint8_t> buttonState(static_cast<size_t>(options.buttons), 0);
+
+    const uint64_t periodNs = 1000000000ull / static_cast<uint64_t>(options.rateHz);
+    const double range = static_cast<double>(options.axisMax) - options.axisMin;
+    const uint64_t startNs = MonotonicNs();
+    const uint64_t endNs = options.durationSec > 0 ? startNs + static_cast<uint64_t>(options.durationSec * 1e9) : UINT64_MAX;
+    uint64_t deadlineNs = startNs;
+    uint64_t reports = 0, events = 0, lateReports = 0, skippedReports = 0, writeErrors = 0, maxLatenessNs = 0;
+    uint32_t random = 0x9E3779B9u;
+    int nextAxis = 0, nextButton = 0;
+
+    auto push = [&](uint16_t type, uint16_t code, int32_t value) {
+        struct input_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.type = type;
+        ev.code = code;
+        ev.value = value;
+        report.push_back(ev);
+    };
+
+    while (!g_quit && deadlineNs < endNs) {
+        if (!recording) SleepUntilNs(deadlineNs);
+        const uint64_t nowNs = recording ? deadlineNs : MonotonicNs();
+        const uint64_t latenessNs = nowNs > deadlineNs ? nowNs - deadlineNs : 0;
+        maxLatenessNs = std::max(maxLatenessNs, latenessNs);
+        if (latenessNs > periodNs / 2) lateReports++;
+
+        report.clear();
+        const double t = static_cast<double>(nowNs - startNs) / 1e6 / options.periodMs;
+        for (int n = 0; n < options.axesPerReport; ++n) {
+            const int i = nextAxis;
+            nextAxis = (nextAxis + 1) % options.axes;
+            const double phase = t + static_cast<double>(i) / options.axes;
+            double norm = 0.5;
+            switch (options.pattern) {
+                case Pattern::SWEEP: {
+                    double frac = phase - std::floor(phase);
+                    norm = frac < 0.5 ? frac * 2.0 : 2.0 - frac * 2.0;
+                    break;
+                }
+                case Pattern::SINE: norm = 0.5 + 0.5 * std::sin(phase * 2.0 * M_PI); break;
+                case Pattern::RANDOM:
+                    random ^= random << 13; random ^= random >> 17; random ^= random << 5;
+                    norm = static_cast<double>(random) / 4294967295.0;
+                    break;
+                case Pattern::HOLD: break;
+            }
+            push(EV_ABS, static_cast<uint16_t>(AxisCode(i)), options.axisMin + static_cast<int32_t>(norm * range + 0.5));
+        }
+        for (int n = 0; n < options.buttonsPerReport; ++n) {
+            const int i = nextButton;
+            nextButton = (nextButton + 1) % options.buttons;
+            buttonState[static_cast<size_t>(i)] ^= 1;
+            push(EV_KEY, static_cast<uint16_t>(BTN_JOYSTICK + i), buttonState[static_cast<size_t>(i)]);
+        }
+        push(EV_SYN, SYN_REPORT, 0);
+
+        const ssize_t bytes = static_cast<ssize_t>(report.size() * sizeof(struct input_event));
+        if (recording) {
+            for (const auto& ev : report) recorder.write({nowNs, 0, ev.type, ev.code, ev.value});
+            reports++;
+            events += report.size() - 1;
+        } else if (write(fd, report.data(), static_cast<size_t>(bytes)) == bytes) {
+            reports++;
+            events += report.size() - 1;
+        } else {
+            writeErrors++;
+        }
+
+        // Fell more than a period behind: skip the missed reports instead of bursting
+        deadlineNs += periodNs;
+        if (nowNs > deadlineNs + periodNs) {
+            const uint64_t missed = (nowNs - deadlineNs) / periodNs;
+            skippedReports += missed;
+            deadlineNs += missed * periodNs;
+        }
+    }
+
+    const double elapsedSec = static_cast<double>(MonotonicNs() - startNs) / 1e9;
+    std::cout << (recording ? "Recorded " : "Sent ") << reports << " report(s) / " << events << " event(s) in " << elapsedSec << " s ("
+              << (elapsedSec > 0 ? reports / elapsedSec : 0.0) << " reports/s); "
+              << lateReports << " late, " << skippedReports << " skipped, " << writeErrors
+              << " write error(s), max lateness " << maxLatenessNs / 1000 << " us" << std::endl;
+
+    if (recording) {
+        recorder.close();
+        return 0;
+    }
+    ioctl(fd, UI_DEV_DESTROY);
+    close(fd);
+    return 0;
+}